@@ -55,8 +55,31 @@ All text above, and the splash screen must be included in any redistribution
 #define TOGGLE_VCOM                                                            \
   do {                                                                         \
     _sharpmem_vcom = _sharpmem_vcom ? 0x00 : SHARPMEM_BIT_VCOM;                \
+    _lastVCOM = millis();                                                      \
   } while (0);
 
+// keeps the error terms of fillEllipse() within 32 bits
+#define SHARPMEM_MAX_ELLIPSE (640)
+
+// keeps the forward differences of drawBezier() within 64 bits
+#define SHARPMEM_MAX_CURVE_STEPS (1024)
+
+#ifdef SHARPMEM_STATS
+#define SHARPMEM_STAT(field, n) (_stats.field += (n))
+#else
+#define SHARPMEM_STAT(field, n)
+#endif
+
+#ifdef SHARPMEM_TRACE
+#define SHARPMEM_TRACE_BEGIN() traceBegin()
+#define SHARPMEM_TRACE_BYTES(data, len) trace(data, len)
+#define SHARPMEM_TRACE_END() traceEnd()
+#else
+#define SHARPMEM_TRACE_BEGIN()
+#define SHARPMEM_TRACE_BYTES(data, len)
+#define SHARPMEM_TRACE_END()
+#endif
+
 /**
  * @brief Construct a new Adafruit_SharpMem object with software SPI
  *
@@ -118,11 +141,23 @@ bool Adafruit_SharpMem::begin(void) {
   // Set the vcom bit to a defined state
   _sharpmem_vcom = SHARPMEM_BIT_VCOM;
 
-  sharpmem_buffer = (uint8_t *)malloc((WIDTH * HEIGHT) / 8);
+  sharpmem_buffer = (uint8_t *)malloc(bufferBytes());
 
   if (!sharpmem_buffer)
     return false;
 
+  // which panel lines are known to be white in the buffer
+  _whiteLines = (uint8_t *)malloc((HEIGHT + 7) / 8);
+
+  if (!_whiteLines)
+    return false;
+
+  // which buffer rows still have to be cleared, see clearDisplayBuffer()
+  _clearRows = (uint8_t *)malloc(((WIDTH > HEIGHT ? WIDTH : HEIGHT) + 7) / 8);
+
+  if (!_clearRows)
+    return false;
+
   setRotation(0);
 
   return true;
@@ -134,6 +169,36 @@ static const uint8_t set[] = {1, 2, 4, 8, 16, 32, 64, 128},
                               (uint8_t)~8,  (uint8_t)~16, (uint8_t)~32,
                               (uint8_t)~64, (uint8_t)~128};
 
+// Colors 2-7 by raw buffer row (y & 3). Bit n is the pixel with (x & 7) == n,
+// and every pattern repeats within a byte, so one byte covers a whole row.
+static const uint8_t patterns[6][4] = {
+    {0xAA, 0x55, 0xAA, 0x55}, // 2: GRAY medium gray
+    {0xAA, 0x00, 0xAA, 0x00}, // 3: DARK darker gray
+    {0x55, 0xFF, 0x55, 0xFF}, // 4: LIGHT lighter gray
+    {0xEE, 0x55, 0xBB, 0x55}, // 5: PATTERN
+    {0xEE, 0xDD, 0xBB, 0x77}, // 6: line pattern
+    {0x77, 0xBB, 0xDD, 0xEE}, // 7: line pattern reversed
+};
+
+/**************************************************************************/
+/*!
+    @brief Gets the bits a color sets in one byte of a buffer row. Every
+   drawing kernel goes through this, so they all agree on the patterns.
+
+    @param color The color, 0 is black and any other color without a pattern
+   is white
+    @param[in]  y
+                The raw buffer row
+    @return The byte to store where all 8 pixels are drawn
+*/
+/**************************************************************************/
+static uint8_t patternByte(uint16_t color, int16_t y) {
+  if ((color < 2) || (color > 7)) {
+    return color ? 0xFF : 0x00;
+  }
+  return patterns[color - 2][y & 3];
+}
+
 /**************************************************************************/
 /*!
     @brief Draws a single pixel in image buffer
@@ -145,13 +210,18 @@ static const uint8_t set[] = {1, 2, 4, 8, 16, 32, 64, 128},
     @param color The color to set:
     * **0**: Black
     * **1**: White
+    * **2-7**: A gray or line pattern, fixed to the buffer so every
+   primitive draws it the same way
 */
 /**************************************************************************/
 void Adafruit_SharpMem::drawPixel(int16_t x, int16_t y, uint16_t color) {
-  if ((x < 0) || (x >= _width) || (y < 0) || (y >= _height))
+  if ((x < 0) || (x >= _width) || (y < 0) || (y >= _height)) {
+    SHARPMEM_STAT(clipped, 1);
     return;
+  }
+  SHARPMEM_STAT(pixels, 1);
 
-  switch (rotation) {
+  switch (_rawRotation) {
   case 1:
     _swap_int16_t(x, y);
     x = WIDTH - 1 - x;
@@ -166,70 +236,25 @@ void Adafruit_SharpMem::drawPixel(int16_t x, int16_t y, uint16_t color) {
     break;
   }
 
-  switch (color) {
-  case 1: // WHITE white
-    // sharpmem_buffer[(y * WIDTH + x) / 8] |= set[x & 7];
-    sharpmem_buffer[(x / 8) + y * ((WIDTH + 7) / 8)] |= set[x & 7];
-    break;
-  default:
-  case 0: // BLACK black
-    // sharpmem_buffer[(y * WIDTH + x) / 8] &= clr[x & 7];
-    sharpmem_buffer[(x / 8) + y * ((WIDTH + 7) / 8)] &= clr[x & 7];
-    break;
-  case 7:
-    // line pattern reversed
-    if (y % 3 == 2 - (x % 3)) {
-      sharpmem_buffer[(y * WIDTH + x) / 8] &= clr[x & 7];
-    } else {
-      sharpmem_buffer[(y * WIDTH + x) / 8] |= set[x & 7];
-    }
-    break;
-  case 6:
-    // line pattern
-    if (y % 3 == x % 3) {
-      sharpmem_buffer[(y * WIDTH + x) / 8] &= clr[x & 7];
-    } else {
-      sharpmem_buffer[(y * WIDTH + x) / 8] |= set[x & 7];
+  // Most pixels land on a row that is already marked written, skip the
+  // bookkeeping unless the row is still to be cleared, white or sent
+  if (_clearCount || _whiteCount || _pendingCount) {
+    int16_t line = (_transposed && (rotation & 1)) ? x : y;
+    if (flip180() != _mirrorY) {
+      line = HEIGHT - 1 - line;
     }
-    break;
-  case 5: // PATTERN
-    // V1
-    if ((y % 4 == 0 && x % 4 == 2) || // line 0
-        (x % 2 == 1 && y % 2 == 1) || // line 1 & 3
-        (y % 4 == 2 && x % 4 == 0)    // line 2
-    ) {
-      // black
-      sharpmem_buffer[(y * WIDTH + x) / 8] &= clr[x & 7];
-    } else {
-      sharpmem_buffer[(y * WIDTH + x) / 8] |= set[x & 7];
+    if ((_clearCount && (_clearRows[y / 8] & set[y & 7])) ||
+        (_whiteCount && (_whiteLines[line / 8] & set[line & 7])) ||
+        (_pendingCount && !(_pendingLines[line / 8] & set[line & 7]))) {
+      bufferChanged(x, y, 1, 1);
     }
+  }
 
-    break;
-  case 4: // LIGHT lighter gray
-    if (y % 2 != 0) {
-      sharpmem_buffer[(y * WIDTH + x) / 8] |= set[x & 7];
-    } else if ((x + 2 * ((y / 2) % 2)) % 4 == 0) { // on
-      sharpmem_buffer[(y * WIDTH + x) / 8] &= clr[x & 7];
-    } else {
-      sharpmem_buffer[(y * WIDTH + x) / 8] |= set[x & 7];
-    }
-    break;
-  case 3:             // DARK darker gray
-    if (y % 2 != 0) { // off
-      sharpmem_buffer[(y * WIDTH + x) / 8] &= clr[x & 7];
-    } else if ((x + 2 * ((y / 2) % 2)) % 4 == 0) { // on
-      sharpmem_buffer[(y * WIDTH + x) / 8] |= set[x & 7];
-    } else {
-      sharpmem_buffer[(y * WIDTH + x) / 8] &= clr[x & 7];
-    }
-    break;
-  case 2: // GRAY medium gray
-    if (((x + y) % 2 == 0)) {
-      sharpmem_buffer[(y * WIDTH + x) / 8] |= set[x & 7];
-    } else {
-      sharpmem_buffer[(y * WIDTH + x) / 8] &= clr[x & 7];
-    }
-    break;
+  uint8_t *ptr = &sharpmem_buffer[(x / 8) + y * _rowBytes];
+  if (patternByte(color, y) & set[x & 7]) {
+    *ptr |= set[x & 7];
+  } else {
+    *ptr &= clr[x & 7];
   }
 }
 
@@ -249,7 +274,7 @@ uint8_t Adafruit_SharpMem::getPixel(uint16_t x, uint16_t y) {
   if ((x >= _width) || (y >= _height))
     return 0; // <0 test not needed, unsigned
 
-  switch (rotation) {
+  switch (_rawRotation) {
   case 1:
     _swap_uint16_t(x, y);
     x = WIDTH - 1 - x;
@@ -264,7 +289,10 @@ uint8_t Adafruit_SharpMem::getPixel(uint16_t x, uint16_t y) {
     break;
   }
 
-  return sharpmem_buffer[(y * WIDTH + x) / 8] & set[x & 7] ? 1 : 0;
+  if (_clearCount && (_clearRows[y / 8] & set[y & 7]))
+    return 1; // cleared, but not written to yet
+
+  return sharpmem_buffer[(x / 8) + y * _rowBytes] & set[x & 7] ? 1 : 0;
 }
 
 /**************************************************************************/
@@ -310,221 +338,3204 @@ void Adafruit_SharpMem::drawFatLine(int16_t x0, int16_t y0, // first point
 */
 /**************************************************************************/
 void Adafruit_SharpMem::clearDisplay() {
-  memset(sharpmem_buffer, 0xff, (WIDTH * HEIGHT) / 8);
+  clearDisplayBuffer();
+  sendClear();
+}
 
+/**************************************************************************/
+/*!
+    @brief Sends the clear screen command, leaving the buffer alone
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::sendClear(void) {
   spidev->beginTransaction();
   // Send the clear screen command rather than doing a HW refresh (quicker)
   digitalWrite(_cs, HIGH);
+  SHARPMEM_TRACE_BEGIN();
 
   uint8_t clear_data[2] = {(uint8_t)(_sharpmem_vcom | SHARPMEM_BIT_CLEAR),
                            0x00};
+  SHARPMEM_TRACE_BYTES(clear_data, 2);
   spidev->transfer(clear_data, 2);
+  SHARPMEM_STAT(clears, 1);
+  SHARPMEM_STAT(bytesSent, 2);
 
   TOGGLE_VCOM;
   digitalWrite(_cs, LOW);
+  SHARPMEM_TRACE_END();
   spidev->endTransaction();
+  _panelWhite = true;
 }
 
 /**************************************************************************/
 /*!
-    @brief Renders the contents of the pixel buffer on the LCD
+    @brief Toggles VCOM without sending any lines. The panel needs VCOM to
+   change about once a second; refresh() and clearDisplay() do it too, so
+   this is for screens that stay static.
 */
 /**************************************************************************/
-void Adafruit_SharpMem::refresh(void) {
-  uint16_t i, currentline;
-
+void Adafruit_SharpMem::maintainVCOM(void) {
   spidev->beginTransaction();
-  // Send the write command
+  // Send the display mode command, which only carries the VCOM bit
   digitalWrite(_cs, HIGH);
+  SHARPMEM_TRACE_BEGIN();
 
-  spidev->transfer(_sharpmem_vcom | SHARPMEM_BIT_WRITECMD);
-  TOGGLE_VCOM;
-
-  uint8_t bytes_per_line = WIDTH / 8;
-  uint16_t totalbytes = (WIDTH * HEIGHT) / 8;
-
-  for (i = 0; i < totalbytes; i += bytes_per_line) {
-    uint8_t line[bytes_per_line + 2];
+  uint8_t vcom_data[2] = {_sharpmem_vcom, 0x00};
+  SHARPMEM_TRACE_BYTES(vcom_data, 2);
+  spidev->transfer(vcom_data, 2);
+  SHARPMEM_STAT(vcomCommands, 1);
+  SHARPMEM_STAT(bytesSent, 2);
 
-    // Send address byte
-    currentline = ((i + 1) / (WIDTH / 8)) + 1;
-    line[0] = currentline;
-    // copy over this line
-    memcpy(line + 1, sharpmem_buffer + i, bytes_per_line);
-    // Send end of line
-    line[bytes_per_line + 1] = 0x00;
-    // send it!
-    spidev->transfer(line, bytes_per_line + 2);
-  }
-
-  // Send another trailing 8 bits for the last line
-  spidev->transfer(0x00);
+  TOGGLE_VCOM;
   digitalWrite(_cs, LOW);
+  SHARPMEM_TRACE_END();
   spidev->endTransaction();
 }
 
 /**************************************************************************/
 /*!
-    @brief Clears the display buffer without outputting to the display
+    @brief Sets how often pollVCOM() toggles VCOM
+
+    @param[in]  ms
+                The most time between two VCOM toggles, 0 to turn pollVCOM()
+                off. 1000 suits most panels.
 */
 /**************************************************************************/
-void Adafruit_SharpMem::clearDisplayBuffer() {
-  memset(sharpmem_buffer, 0xff, (WIDTH * HEIGHT) / 8);
+void Adafruit_SharpMem::setVCOMInterval(uint16_t ms) { _vcomInterval = ms; }
+
+/**************************************************************************/
+/*!
+    @brief Toggles VCOM if nothing else did within the interval set by
+   setVCOMInterval(). Call it from loop() or a periodic timer tick that does
+   not interrupt other users of the SPI bus.
+
+    @return true if the VCOM command was sent
+*/
+/**************************************************************************/
+bool Adafruit_SharpMem::pollVCOM(void) {
+  // an incremental refresh in progress sends VCOM with its next step
+  if (!_vcomInterval || _extComIn || !refreshDone() ||
+      (millis() - _lastVCOM < _vcomInterval)) {
+    return false;
+  }
+  maintainVCOM();
+  return true;
 }
 
 /**************************************************************************/
 /*!
-    @brief access to the raw display buffer
+    @brief Selects hardware VCOM, for boards with EXTMODE wired high. The
+   panel then takes VCOM from the EXTCOMIN pin and ignores the VCOM bit of
+   every command, so static screens need no SPI traffic at all and
+   pollVCOM() does nothing.
+
+    @param[in]  enable
+                true if EXTMODE is high, false to go back to software VCOM
+    @param[in]  pin
+                The pin wired to EXTCOMIN, to have it driven by tone() (a
+                hardware timer on most cores), or -1 if something else
+                drives it
+    @param[in]  hz
+                The EXTCOMIN frequency, within the range the panel datasheet
+                allows
 */
 /**************************************************************************/
-void Adafruit_SharpMem::copyPixelBuffer(uint8_t *bitmap) {
-  memcpy(bitmap, sharpmem_buffer, (WIDTH * HEIGHT) / 8);
+void Adafruit_SharpMem::setExtComIn(bool enable, int8_t pin, uint16_t hz) {
+  if (_extComInPin >= 0) {
+    noTone(_extComInPin);
+    digitalWrite(_extComInPin, LOW);
+  }
+  _extComIn = enable;
+  _extComInPin = enable ? pin : -1;
+  if (_extComInPin >= 0) {
+    pinMode(_extComInPin, OUTPUT);
+    tone(_extComInPin, hz);
+  }
 }
+
 /**************************************************************************/
 /*!
-    @brief fills the display buffer with contents of bitmap without outputting
-   to the display
+    @brief Renders the contents of the pixel buffer on the LCD
 */
 /**************************************************************************/
+void Adafruit_SharpMem::refresh(void) {
+#ifdef SHARPMEM_STATS
+  uint32_t start = micros();
+#endif
+
+  if (_background || _shownSprites) {
+    // white in the buffer says nothing about the combined image
+    sendLines(0, HEIGHT - 1);
+  } else if (_whiteCount == HEIGHT) {
+    // a white frame is what the 2 byte clear command produces
+    sendClear();
+  } else if (_panelWhite && _whiteCount) {
+    // white lines are already white on the panel
+    sendLines(0, HEIGHT - 1, _whiteLines);
+  } else {
+    sendLines(0, HEIGHT - 1);
+  }
 
-void Adafruit_SharpMem::setBitmap(uint8_t *bitmap) {
-  memcpy(sharpmem_buffer, bitmap, (WIDTH * HEIGHT) / 8);
+  SHARPMEM_STAT(refreshes, 1);
+  SHARPMEM_STAT(refreshMicros, micros() - start);
 }
 
 /**************************************************************************/
-void Adafruit_SharpMem::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
-                                 uint16_t color) {
-  for (int16_t i = y; i < y + h; i++) {
-    drawFastHLine(x, i, w, color);
+/*!
+    @brief Renders a range of panel lines from the pixel buffer on the LCD
+
+    @param[in]  first
+                The first panel line to send (0 based)
+    @param[in]  last
+                The last panel line to send, inclusive
+    @return The number of lines sent
+*/
+/**************************************************************************/
+uint16_t Adafruit_SharpMem::refreshLines(uint16_t first, uint16_t last) {
+  if (last >= HEIGHT) {
+    last = HEIGHT - 1;
   }
+  if (first > last) {
+    return 0;
+  }
+#ifdef SHARPMEM_STATS
+  uint32_t start = micros();
+#endif
+  sendLines(first, last);
+  SHARPMEM_STAT(refreshes, 1);
+  SHARPMEM_STAT(refreshMicros, micros() - start);
+  return last - first + 1;
 }
 
 /**************************************************************************/
-void Adafruit_SharpMem::fillCircle(int16_t x0, int16_t y0, int16_t r,
-                                   uint16_t color) {
-  startWrite();
-  writeFastHLine(x0 - r, y0, 2 * r + 1, color);
-  fillCircleHelper(x0, y0, r, 3, 0, color);
-  endWrite();
+/*!
+    @brief Renders the panel lines covering a rectangle of the pixel buffer
+   on the LCD
+
+    @param[in]  x
+                The left edge, in the current rotation
+    @param[in]  y
+                The top edge, in the current rotation
+    @param[in]  w
+                The width
+    @param[in]  h
+                The height
+    @return The number of lines sent
+*/
+/**************************************************************************/
+uint16_t Adafruit_SharpMem::refreshRect(int16_t x, int16_t y, int16_t w,
+                                        int16_t h) {
+  // Whatever the buffer layout, the panel shows the drawing rotated by
+  // 'rotation' and then mirrored
+  if (!rawRect(x, y, w, h, rotation)) {
+    return 0;
+  }
+  if (_mirrorY) {
+    y = HEIGHT - y - h;
+  }
+  return refreshLines(y, y + h - 1);
+}
+
+// Whether a line is set in an optional bitmap of lines to skip
+static inline bool skipped(const uint8_t *skip, uint16_t line) {
+  return skip && (skip[line / 8] & set[line & 7]);
 }
 
 /**************************************************************************/
-//*
-void Adafruit_SharpMem::fillCircleHelper(int16_t x0, int16_t y0, int16_t r,
-                                         uint8_t corners, int16_t delta,
-                                         uint16_t color) {
-  int16_t f = 1 - r;
-  int16_t ddF_y = 1;
-  int16_t ddF_x = -2 * r;
-  int16_t y = 0;
-  int16_t x = r;
-  int16_t py = y;
-  int16_t px = x;
+/*!
+    @brief Sends a range of panel lines in one write command
+
+    @param[in]  first
+                The first panel line to send (0 based)
+    @param[in]  last
+                The last panel line to send, inclusive
+    @param[in]  skip
+                Optional bitmap of lines not to send
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::sendLines(uint16_t first, uint16_t last,
+                                  const uint8_t *skip) {
+  uint16_t currentline = first;
+
+  // Every chunk repeats the write command; they all belong to one frame, so
+  // they carry the same VCOM state
+  uint8_t cmd = _sharpmem_vcom | SHARPMEM_BIT_WRITECMD;
+  TOGGLE_VCOM;
 
-  delta++; // Avoid some +1's in the loop
+  // micros() costs several us on some cores, only a hold time needs it
+  bool timed = _maxHoldMicros;
 
-  while (y < x) {
-    if (f >= 0) {
-      x--;
-      ddF_x += 2;
-      f += ddF_x;
+  for (;;) {
+    uint16_t sent = 0;
+    uint32_t start = timed ? micros() : 0, lineTime = 0;
+
+    while ((currentline <= last) && skipped(skip, currentline)) {
+      currentline++;
     }
-    y++;
-    ddF_y += 2;
-    f += ddF_y;
-    // These checks avoid double-drawing certain lines, important
-    // for the SSD1306 library which has an INVERT drawing mode.
-    if (y < (x + 1)) {
-      if (corners & 1)
-        writeFastHLine(x0 - x, y0 + y, 2 * x + delta, color);
-      if (corners & 2)
-        writeFastHLine(x0 - x, y0 - y, 2 * x + delta, color);
+    if (currentline > last) {
+      break;
     }
-    if (x != px) {
-      if (corners & 1)
-        writeFastHLine(x0 - py, y0 + px, 2 * py + delta, color);
-      if (corners & 2)
-        writeFastHLine(x0 - py, y0 - px, 2 * py + delta, color);
-      px = x;
+
+    beginLines(cmd);
+    do {
+      uint32_t t = timed ? micros() : 0;
+      sendLine(currentline);
+      lineTime = timed ? micros() - t : 0;
+      currentline++;
+      sent++;
+      while ((currentline <= last) && skipped(skip, currentline)) {
+        currentline++;
+      }
+    } while ((currentline <= last) &&
+             (!_chunkLines || (sent < _chunkLines)) &&
+             (!_maxHoldMicros ||
+              (micros() - start + lineTime <= _maxHoldMicros)));
+    endLines();
+
+    if (currentline <= last) {
+      yield(); // let whoever else is on the bus have a go
     }
-    py = y;
   }
 }
 
 /**************************************************************************/
-void Adafruit_SharpMem::drawFastHLine(int16_t x, int16_t y, int16_t w,
-                                      uint16_t color) {
-  if (w < 0) { // Convert negative widths to positive equivalent
-    w *= -1;
-    x -= w - 1;
-    if (x < 0) {
-      w += x;
-      x = 0;
+/*!
+    @brief Opens an SPI transaction and sends a write command
+
+    @param[in]  cmd
+                The command byte, including the VCOM state
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::beginLines(uint8_t cmd) {
+  spidev->beginTransaction();
+  // Send the write command
+  digitalWrite(_cs, HIGH);
+  SHARPMEM_TRACE_BEGIN();
+
+  SHARPMEM_TRACE_BYTES(&cmd, 1);
+  spidev->transfer(cmd);
+  SHARPMEM_STAT(bytesSent, 1);
+  _cachedGroup = -1; // the buffer may have changed since the last time
+  _panelWhite = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief Sends one panel line, after beginLines()
+
+    @param[in]  currentline
+                The panel line (0 based)
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::sendLine(uint16_t currentline) {
+  uint8_t bytes_per_line = (WIDTH + 7) / 8;
+  uint8_t line[bytes_per_line + 2];
+
+  // Send address byte
+  line[0] = currentline + 1;
+  // copy over this line
+  fetchLine(currentline, line + 1);
+  // Send end of line
+  line[bytes_per_line + 1] = 0x00;
+  // send it!
+  SHARPMEM_TRACE_BYTES(line, bytes_per_line + 2);
+  spidev->transfer(line, bytes_per_line + 2);
+  SHARPMEM_STAT(linesSent, 1);
+  SHARPMEM_STAT(bytesSent, bytes_per_line + 2);
+}
+
+/**************************************************************************/
+/*!
+    @brief Finishes a write command and closes the SPI transaction
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::endLines(void) {
+  // Send another trailing 8 bits for the last line
+  uint8_t trailer = 0x00;
+  SHARPMEM_TRACE_BYTES(&trailer, 1);
+  spidev->transfer(trailer);
+  SHARPMEM_STAT(bytesSent, 1);
+  digitalWrite(_cs, LOW);
+  SHARPMEM_TRACE_END();
+  spidev->endTransaction();
+}
+
+/**************************************************************************/
+/*!
+    @brief Starts a refresh that is sent in slices by refreshStep(), for main
+   loops that cannot block for a whole frame. Every line is queued; lines
+   drawn to before the refresh is done are queued again, even if they were
+   already sent.
+
+    @return true on success, false if there was no memory for the line queue
+*/
+/**************************************************************************/
+bool Adafruit_SharpMem::beginRefresh(void) {
+  if (!_pendingLines) {
+    _pendingLines = (uint8_t *)malloc((HEIGHT + 7) / 8);
+    if (!_pendingLines) {
+      return false;
     }
   }
+  memset(_pendingLines, 0xff, (HEIGHT + 7) / 8);
+  _pendingCount = HEIGHT;
+  _nextLine = 0;
 
-  // Edge rejection (no-draw if totally off canvas)
-  if ((y < 0) || (y >= height()) || (x >= width()) || ((x + w - 1) < 0)) {
-    return;
+  // one frame, one VCOM state
+  _stepCmd = _sharpmem_vcom | SHARPMEM_BIT_WRITECMD;
+  TOGGLE_VCOM;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Sends the next slice of a refresh started with beginRefresh()
+
+    @param[in]  maxLines
+                Most lines to send in this step, 0 for no limit
+    @param[in]  maxMicros
+                Most time to spend in this step, 0 for no limit. A step
+                always sends at least one line.
+    @return true once the refresh is done
+*/
+/**************************************************************************/
+bool Adafruit_SharpMem::refreshStep(uint16_t maxLines, uint32_t maxMicros) {
+  if (refreshDone()) {
+    return true;
   }
 
-  if (x < 0) { // Clip left
-    w += x;
-    x = 0;
+  // the clock is only read for a time limit, and for the stats
+  bool timed = maxMicros;
+#ifdef SHARPMEM_STATS
+  timed = true;
+#endif
+  uint16_t sent = 0;
+  uint32_t start = timed ? micros() : 0, lineTime = 0;
+
+  beginLines(_stepCmd);
+  do {
+    // lines queued again behind us are picked up on the next pass
+    while (!(_pendingLines[_nextLine / 8] & set[_nextLine & 7])) {
+      _nextLine = (_nextLine + 1 < HEIGHT) ? _nextLine + 1 : 0;
+    }
+    uint32_t t = maxMicros ? micros() : 0;
+    _pendingLines[_nextLine / 8] &= clr[_nextLine & 7];
+    _pendingCount--;
+    sendLine(_nextLine);
+    lineTime = maxMicros ? micros() - t : 0;
+    sent++;
+  } while (_pendingCount && (!maxLines || (sent < maxLines)) &&
+           (!maxMicros || (micros() - start + lineTime <= maxMicros)));
+  endLines();
+
+  SHARPMEM_STAT(refreshes, 1);
+  SHARPMEM_STAT(refreshMicros, micros() - start);
+
+  return refreshDone();
+}
+
+/**************************************************************************/
+/*!
+    @brief Checks whether a refresh started with beginRefresh() is done
+
+    @return true if every queued line has been sent
+*/
+/**************************************************************************/
+bool Adafruit_SharpMem::refreshDone(void) { return _pendingCount == 0; }
+
+/**************************************************************************/
+/*!
+    @brief Records that a rectangle of the buffer is about to be written.
+   Rows in it that were only marked cleared get cleared, and an incremental
+   refresh in progress sends the panel lines it covers again.
+
+    @param[in]  x
+                The left edge, in buffer coordinates
+    @param[in]  y
+                The top edge, in buffer coordinates
+    @param[in]  w
+                The width
+    @param[in]  h
+                The height
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::bufferChanged(int16_t x, int16_t y, int16_t w,
+                                      int16_t h) {
+  clearRows(y, h);
+
+  if (!_pendingCount && !_whiteCount) {
+    return;
   }
-  if (x + w >= width()) { // Clip right
-    w = width() - x;
+
+  panelLines(x, y, w, h);
+  for (int16_t i = y; i < y + h; i++) {
+    if (_pendingCount && !(_pendingLines[i / 8] & set[i & 7])) {
+      _pendingLines[i / 8] |= set[i & 7];
+      _pendingCount++;
+    }
+    if (_whiteLines[i / 8] & set[i & 7]) {
+      _whiteLines[i / 8] &= clr[i & 7];
+      _whiteCount--;
+    }
   }
+}
 
-  if (getRotation() == 0) {
-    drawFastRawHLine(x, y, w, color);
-  } else if (getRotation() == 1) {
-    int16_t t = x;
-    x = WIDTH - 1 - y;
-    y = t;
-    drawFastRawVLine(x, y, w, color);
-  } else if (getRotation() == 2) {
-    x = WIDTH - 1 - x;
-    y = HEIGHT - 1 - y;
+/**************************************************************************/
+/*!
+    @brief Finds the panel lines a rectangle of the buffer ends up on
 
-    x -= w - 1;
-    drawFastRawHLine(x, y, w, color);
-  } else if (getRotation() == 3) {
-    int16_t t = x;
-    x = y;
-    y = HEIGHT - 1 - t;
-    y -= w - 1;
-    drawFastRawVLine(x, y, w, color);
+    @param[in]  x
+                The left edge, in buffer coordinates
+    @param[in,out]  y
+                    The top edge, replaced by the first panel line
+    @param[in]  w
+                The width
+    @param[in,out]  h
+                    The height, replaced by the number of panel lines
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::panelLines(int16_t x, int16_t &y, int16_t w,
+                                   int16_t &h) {
+  // Buffer rows are panel lines, unless the buffer is transposed and its
+  // columns are
+  if (_transposed && (rotation & 1)) {
+    y = x;
+    h = w;
+  }
+  if (flip180() != _mirrorY) {
+    y = HEIGHT - y - h;
   }
 }
 
 /**************************************************************************/
-void Adafruit_SharpMem::drawFastRawVLine(int16_t x, int16_t y, int16_t h,
-                                         uint16_t color) {
-  // x & y already in raw (rotation 0) coordinates, no need to transform.
-  int16_t row_bytes = ((WIDTH + 7) / 8);
-  uint8_t *ptr = &sharpmem_buffer[(x / 8) + y * row_bytes];
+/*!
+    @brief Records that the whole buffer was written
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::bufferChanged(void) {
+  int16_t x = 0, y = 0, w = _width, h = _height;
 
-  if (color > 0) {
-    uint8_t bit_mask = set[x & 7]; // CHANGED
-    if (color == 2) {              // GRAY
-      if (y % 2 == 0) {
-        bit_mask &= 0xAA;
-      } else {
-        bit_mask &= 0x55;
-      }
-    }
+  rawRect(x, y, w, h, _rawRotation);
+  bufferChanged(x, y, w, h);
+}
 
-    for (int16_t i = 0; i < h; i++) {
-      *ptr |= bit_mask;
-      ptr += row_bytes;
-    }
-  } else {                         // BLACK
-    uint8_t bit_mask = clr[x & 7]; // CHANGED
+/**************************************************************************/
+/*!
+    @brief Splits refreshes into several SPI transactions so other devices
+   on the same bus are not locked out for a whole frame. Between chunks the
+   bus is released and yield() is called.
+
+    @param[in]  maxLines
+                Most lines to send per transaction, 0 for no limit
+    @param[in]  maxHoldMicros
+                Most time to hold the bus per transaction, 0 for no limit. A
+                chunk always sends at least one line.
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::setRefreshChunking(uint16_t maxLines,
+                                           uint32_t maxHoldMicros) {
+  _chunkLines = maxLines;
+  _maxHoldMicros = maxHoldMicros;
+}
 
-    for (int16_t i = 0; i < h; i++) {
-      *ptr &= bit_mask;
-      ptr += row_bytes;
+// Bit-reversed value of every byte, for sending a row right to left
+static const uint8_t reversed[256] PROGMEM = {
+    0x00, 0x80, 0x40, 0xC0, 0x20, 0xA0, 0x60, 0xE0, 0x10, 0x90, 0x50, 0xD0,
+    0x30, 0xB0, 0x70, 0xF0, 0x08, 0x88, 0x48, 0xC8, 0x28, 0xA8, 0x68, 0xE8,
+    0x18, 0x98, 0x58, 0xD8, 0x38, 0xB8, 0x78, 0xF8, 0x04, 0x84, 0x44, 0xC4,
+    0x24, 0xA4, 0x64, 0xE4, 0x14, 0x94, 0x54, 0xD4, 0x34, 0xB4, 0x74, 0xF4,
+    0x0C, 0x8C, 0x4C, 0xCC, 0x2C, 0xAC, 0x6C, 0xEC, 0x1C, 0x9C, 0x5C, 0xDC,
+    0x3C, 0xBC, 0x7C, 0xFC, 0x02, 0x82, 0x42, 0xC2, 0x22, 0xA2, 0x62, 0xE2,
+    0x12, 0x92, 0x52, 0xD2, 0x32, 0xB2, 0x72, 0xF2, 0x0A, 0x8A, 0x4A, 0xCA,
+    0x2A, 0xAA, 0x6A, 0xEA, 0x1A, 0x9A, 0x5A, 0xDA, 0x3A, 0xBA, 0x7A, 0xFA,
+    0x06, 0x86, 0x46, 0xC6, 0x26, 0xA6, 0x66, 0xE6, 0x16, 0x96, 0x56, 0xD6,
+    0x36, 0xB6, 0x76, 0xF6, 0x0E, 0x8E, 0x4E, 0xCE, 0x2E, 0xAE, 0x6E, 0xEE,
+    0x1E, 0x9E, 0x5E, 0xDE, 0x3E, 0xBE, 0x7E, 0xFE, 0x01, 0x81, 0x41, 0xC1,
+    0x21, 0xA1, 0x61, 0xE1, 0x11, 0x91, 0x51, 0xD1, 0x31, 0xB1, 0x71, 0xF1,
+    0x09, 0x89, 0x49, 0xC9, 0x29, 0xA9, 0x69, 0xE9, 0x19, 0x99, 0x59, 0xD9,
+    0x39, 0xB9, 0x79, 0xF9, 0x05, 0x85, 0x45, 0xC5, 0x25, 0xA5, 0x65, 0xE5,
+    0x15, 0x95, 0x55, 0xD5, 0x35, 0xB5, 0x75, 0xF5, 0x0D, 0x8D, 0x4D, 0xCD,
+    0x2D, 0xAD, 0x6D, 0xED, 0x1D, 0x9D, 0x5D, 0xDD, 0x3D, 0xBD, 0x7D, 0xFD,
+    0x03, 0x83, 0x43, 0xC3, 0x23, 0xA3, 0x63, 0xE3, 0x13, 0x93, 0x53, 0xD3,
+    0x33, 0xB3, 0x73, 0xF3, 0x0B, 0x8B, 0x4B, 0xCB, 0x2B, 0xAB, 0x6B, 0xEB,
+    0x1B, 0x9B, 0x5B, 0xDB, 0x3B, 0xBB, 0x7B, 0xFB, 0x07, 0x87, 0x47, 0xC7,
+    0x27, 0xA7, 0x67, 0xE7, 0x17, 0x97, 0x57, 0xD7, 0x37, 0xB7, 0x77, 0xF7,
+    0x0F, 0x8F, 0x4F, 0xCF, 0x2F, 0xAF, 0x6F, 0xEF, 0x1F, 0x9F, 0x5F, 0xDF,
+    0x3F, 0xBF, 0x7F, 0xFF};
+
+// Reversing the bytes of a line puts pixel x at bytes * 8 - 1 - x, which is
+// 'pad' columns right of where it belongs when the width is not a multiple
+// of 8; move the line back down.
+static void alignReversed(uint8_t *line, uint8_t bytes, uint8_t pad) {
+  for (uint8_t i = 0; i < bytes; i++) {
+    uint16_t v = line[i];
+    if (i + 1 < bytes) {
+      v |= line[i + 1] << 8;
+    }
+    line[i] = v >> pad;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Produces the bytes the panel expects for one of its lines
+
+    @param[in]  line
+                The panel line (0 based)
+    @param[out] dst
+                Where to put the line, (WIDTH + 7) / 8 bytes
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::fetchLine(uint16_t line, uint8_t *dst) {
+  uint8_t bytes_per_line = (WIDTH + 7) / 8;
+  bool transposed = _transposed && (rotation & 1);
+
+  // A 180 degree rotation done here is a mirror along both axes
+  bool flip = flip180();
+
+  if (flip != _mirrorY) { // last row first
+    line = HEIGHT - 1 - line;
+  }
+
+  if (transposed) {
+    // Panel line n is buffer column n; transpose the 8 columns it shares its
+    // bytes with once and serve the other 7 lines from the cache.
+    if (_cachedGroup != (int16_t)(line / 8)) {
+      transposeLines(line / 8, flip != _mirrorX);
+    }
+    memcpy(dst, _lineCache + (line & 7) * bytes_per_line, bytes_per_line);
+    return;
+  }
+
+  bool cleared = _clearCount && (_clearRows[line / 8] & set[line & 7]);
+  const uint8_t *src = sharpmem_buffer + line * _rowBytes;
+
+  if (!_background && !_shownSprites && !cleared) {
+    if (flip != _mirrorX) { // each row right to left
+      for (uint8_t i = 0; i < bytes_per_line; i++) {
+        dst[i] = pgm_read_byte(&reversed[src[bytes_per_line - 1 - i]]);
+      }
+      if (WIDTH & 7) {
+        alignReversed(dst, bytes_per_line, 8 - (WIDTH & 7));
+      }
+    } else {
+      memcpy(dst, src, bytes_per_line);
+    }
+    return;
+  }
+
+  if (cleared) {
+    memset(dst, 0xff, bytes_per_line); // cleared, but not written to yet
+  } else {
+    memcpy(dst, src, bytes_per_line);
+  }
+  if (_background) {
+    uint16_t offset = line * _rowBytes;
+    for (uint8_t i = 0; i < bytes_per_line; i++) {
+      dst[i] = compose(dst[i], offset + i);
+    }
+  }
+  if (_shownSprites) {
+    for (uint8_t i = 0; i < bytes_per_line; i++) {
+      dst[i] = overlay(dst[i], line, i);
+    }
+  }
+  if (flip != _mirrorX) { // each row right to left, in place
+    for (uint8_t i = 0; i < bytes_per_line / 2; i++) {
+      uint8_t t = pgm_read_byte(&reversed[dst[i]]);
+      dst[i] = pgm_read_byte(&reversed[dst[bytes_per_line - 1 - i]]);
+      dst[bytes_per_line - 1 - i] = t;
+    }
+    if (bytes_per_line & 1) {
+      dst[bytes_per_line / 2] =
+          pgm_read_byte(&reversed[dst[bytes_per_line / 2]]);
+    }
+    if (WIDTH & 7) {
+      alignReversed(dst, bytes_per_line, 8 - (WIDTH & 7));
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Combines a byte of the buffer with the background layer
+
+    @param[in]  fg
+                The byte from the buffer
+    @param[in]  offset
+                Where the byte is in the buffer
+    @return The byte to send
+*/
+/**************************************************************************/
+uint8_t Adafruit_SharpMem::compose(uint8_t fg, uint16_t offset) {
+  uint8_t bg = _background[offset];
+
+  switch (_backgroundRule) {
+  case SHARPMEM_LAYER_OR:
+    return fg | bg;
+  case SHARPMEM_LAYER_XOR: // on black ink, not on white bits
+    return ~(fg ^ bg);
+  case SHARPMEM_LAYER_MASK:
+    return (fg & _backgroundMask[offset]) | (bg & ~_backgroundMask[offset]);
+  default:
+  case SHARPMEM_LAYER_AND:
+    return fg & bg;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Draws the visible sprites over a byte of the buffer
+
+    @param[in]  v
+                The byte from the buffer
+    @param[in]  row
+                The buffer row the byte is in
+    @param[in]  col
+                The byte column the byte is in
+    @return The byte to send
+*/
+/**************************************************************************/
+uint8_t Adafruit_SharpMem::overlay(uint8_t v, int16_t row, int16_t col) {
+  for (uint8_t n = 0; n < SHARPMEM_SPRITES; n++) {
+    Sprite *s = &_sprites[n];
+
+    if (!s->visible || (row < s->ry) || (row >= s->ry + s->rh)) {
+      continue;
+    }
+    int16_t x0 = (col * 8 > s->rx) ? col * 8 : s->rx;
+    int16_t x1 = (col * 8 + 8 < s->rx + s->rw) ? col * 8 + 8 : s->rx + s->rw;
+
+    for (int16_t x = x0; x < x1; x++) {
+      // back from buffer to drawing coordinates, then into the sprite
+      int16_t ux = x, uy = row;
+      switch (_rawRotation) {
+      case 1:
+        ux = row;
+        uy = WIDTH - 1 - x;
+        break;
+      case 2:
+        ux = WIDTH - 1 - x;
+        uy = HEIGHT - 1 - row;
+        break;
+      case 3:
+        ux = HEIGHT - 1 - row;
+        uy = x;
+        break;
+      }
+      ux -= s->x;
+      uy -= s->y;
+
+      uint16_t i = uy * ((s->w + 7) / 8) + ux / 8;
+      if (s->mask && !(s->mask[i] & set[ux & 7])) {
+        continue; // transparent
+      }
+      if (s->bitmap[i] & set[ux & 7]) {
+        v |= set[x & 7];
+      } else {
+        v &= clr[x & 7];
+      }
+    }
+  }
+  return v;
+}
+
+/**************************************************************************/
+/*!
+    @brief Sets the image of an overlay sprite. Sprites are drawn over the
+   buffer by refresh() while sending, so moving one never needs the pixels
+   underneath restored. They start hidden at 0, 0.
+
+    @param[in]  n
+                The sprite, 0 to SHARPMEM_SPRITES - 1
+    @param[in]  bitmap
+                The image, w by h pixels in the buffer format and in the
+                orientation of the current rotation. It is used in place,
+                not copied.
+    @param[in]  w
+                The width of the image
+    @param[in]  h
+                The height of the image
+    @param[in]  mask
+                Optional mask in the same format, clear bits are
+                transparent. Without one the whole image is opaque.
+    @return true on success, false if n is out of range or there was no
+   memory for the sprite table
+*/
+/**************************************************************************/
+bool Adafruit_SharpMem::setSprite(uint8_t n, const uint8_t *bitmap,
+                                  uint16_t w, uint16_t h,
+                                  const uint8_t *mask) {
+  if (n >= SHARPMEM_SPRITES) {
+    return false;
+  }
+  if (!_sprites) {
+    _sprites = (Sprite *)calloc(SHARPMEM_SPRITES, sizeof(Sprite));
+    if (!_sprites) {
+      return false;
+    }
+  }
+
+  Sprite *s = &_sprites[n];
+  spriteChanged(n);
+  s->bitmap = bitmap;
+  s->mask = mask;
+  s->w = w;
+  s->h = h;
+  placeSprite(n);
+  spriteChanged(n);
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Moves an overlay sprite
+
+    @param[in]  n
+                The sprite, 0 to SHARPMEM_SPRITES - 1
+    @param[in]  x
+                The left edge, in the current rotation
+    @param[in]  y
+                The top edge, in the current rotation
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::moveSprite(uint8_t n, int16_t x, int16_t y) {
+  if (!_sprites || (n >= SHARPMEM_SPRITES)) {
+    return;
+  }
+  spriteChanged(n); // the lines it leaves
+  _sprites[n].x = x;
+  _sprites[n].y = y;
+  placeSprite(n);
+  spriteChanged(n); // the lines it enters
+}
+
+/**************************************************************************/
+/*!
+    @brief Shows or hides an overlay sprite
+
+    @param[in]  n
+                The sprite, 0 to SHARPMEM_SPRITES - 1
+    @param[in]  visible
+                true to show it, false to hide it
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::showSprite(uint8_t n, bool visible) {
+  if (!_sprites || (n >= SHARPMEM_SPRITES) ||
+      (_sprites[n].visible == visible)) {
+    return;
+  }
+  spriteChanged(n); // the lines it leaves, while it is still visible
+  _sprites[n].visible = visible;
+  _shownSprites += visible ? 1 : -1;
+  spriteChanged(n); // the lines it enters
+}
+
+/**************************************************************************/
+/*!
+    @brief Works out where in the buffer a sprite lands
+
+    @param[in]  n
+                The sprite
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::placeSprite(uint8_t n) {
+  Sprite *s = &_sprites[n];
+
+  s->rx = s->x;
+  s->ry = s->y;
+  s->rw = s->bitmap ? s->w : 0;
+  s->rh = s->h;
+  if (!rawRect(s->rx, s->ry, s->rw, s->rh, _rawRotation)) {
+    s->rw = s->rh = 0;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Queues the panel lines under a visible sprite again if an
+   incremental refresh is in progress
+
+    @param[in]  n
+                The sprite
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::spriteChanged(uint8_t n) {
+  Sprite *s = &_sprites[n];
+  int16_t y = s->ry, h = s->rh;
+
+  if (!_pendingCount || !s->visible) {
+    return;
+  }
+  panelLines(s->rx, y, s->rw, h);
+  for (int16_t i = y; i < y + h; i++) {
+    if (!(_pendingLines[i / 8] & set[i & 7])) {
+      _pendingLines[i / 8] |= set[i & 7];
+      _pendingCount++;
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Sets a static background layer that refresh() combines with the
+   buffer while sending, so only the changing foreground has to be cleared
+   and redrawn each frame. getPixel() and copyPixelBuffer() still see the
+   foreground alone.
+
+    @param[in]  background
+                The background, in the layout copyPixelBuffer() returns
+                without rotation, or NULL to remove the layer. It is used in
+                place, not copied.
+    @param[in]  rule
+                How to combine the layers: SHARPMEM_LAYER_AND (black in
+                either is black), SHARPMEM_LAYER_OR (white in either is
+                white), SHARPMEM_LAYER_XOR (background inverted where the
+                foreground is black) or SHARPMEM_LAYER_MASK
+    @param[in]  mask
+                For SHARPMEM_LAYER_MASK, same layout as the background: set
+                bits show the foreground, clear bits the background
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::setBackground(const uint8_t *background, uint8_t rule,
+                                      const uint8_t *mask) {
+  if ((rule == SHARPMEM_LAYER_MASK) && !mask) {
+    rule = SHARPMEM_LAYER_AND;
+  }
+  _background = background;
+  _backgroundRule = rule;
+  _backgroundMask = mask;
+
+  // every panel line changes: lines a refresh in progress already sent go
+  // out again, and none is known to be white on the panel any more
+  if (_pendingCount) {
+    memset(_pendingLines, 0xff, (HEIGHT + 7) / 8);
+    _pendingCount = HEIGHT;
+  }
+  forgetWhiteLines();
+  _panelWhite = false;
+}
+
+// Transposes an 8x8 block of pixels: bit j of src row i ends up as bit i of
+// dst row j. Rows are 'stride' bytes apart, a negative stride walks upwards.
+static void transpose8x8(const uint8_t *src, int16_t srcStride, uint8_t *dst,
+                         int16_t dstStride) {
+  uint32_t x = 0, y = 0, t;
+
+  for (uint8_t i = 0; i < 4; i++) {
+    y |= (uint32_t)src[i * srcStride] << (8 * i);
+    x |= (uint32_t)src[(i + 4) * srcStride] << (8 * i);
+  }
+
+  // Swap 1x1, then 2x2, then 4x4 sub-blocks across the diagonal
+  t = (x ^ (x >> 7)) & 0x00AA00AA;
+  x = x ^ t ^ (t << 7);
+  t = (y ^ (y >> 7)) & 0x00AA00AA;
+  y = y ^ t ^ (t << 7);
+  t = (x ^ (x >> 14)) & 0x0000CCCC;
+  x = x ^ t ^ (t << 14);
+  t = (y ^ (y >> 14)) & 0x0000CCCC;
+  y = y ^ t ^ (t << 14);
+  t = (x & 0xF0F0F0F0) | ((y >> 4) & 0x0F0F0F0F);
+  y = ((x << 4) & 0xF0F0F0F0) | (y & 0x0F0F0F0F);
+  x = t;
+
+  for (uint8_t i = 0; i < 4; i++) {
+    dst[i * dstStride] = y >> (8 * i);
+    dst[(i + 4) * dstStride] = x >> (8 * i);
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Fills the line cache with 8 panel lines taken from the columns of
+   a transposed buffer
+
+    @param[in]  group
+                Which 8 panel lines, i.e. which byte column of the buffer
+    @param[in]  reverse
+                true to send each line right to left
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::transposeLines(uint16_t group, bool reverse) {
+  uint8_t bytes_per_line = WIDTH / 8; // a multiple of 8 when transposed
+
+  // every buffer row contributes to every panel line
+  clearRows(0, _bufferRows);
+
+  // Buffer row r is panel column WIDTH - 1 - r, so a right to left line
+  // reads the rows top down and a normal one reads them bottom up.
+  for (uint8_t k = 0; k < bytes_per_line; k++) {
+    uint8_t block[8];
+
+    for (uint8_t i = 0; i < 8; i++) {
+      uint16_t row = reverse ? k * 8 + i : WIDTH - 1 - k * 8 - i;
+      uint16_t offset = row * _rowBytes + group;
+      block[i] = _background ? compose(sharpmem_buffer[offset], offset)
+                             : sharpmem_buffer[offset];
+      if (_shownSprites) {
+        block[i] = overlay(block[i], row, group);
+      }
+    }
+    transpose8x8(block, 1, _lineCache + k, bytes_per_line);
+  }
+  _cachedGroup = group;
+}
+
+/**************************************************************************/
+/*!
+    @brief Checks whether refresh() turns the buffer by 180 degrees
+
+    @return true if rotation 2 or 3 is applied while sending. A transposed
+   buffer always holds rotation 1, rotation 3 is that plus 180.
+*/
+/**************************************************************************/
+bool Adafruit_SharpMem::flip180(void) {
+  return (_rotateOnRefresh || (_transposed && (rotation & 1))) &&
+         (rotation & 2);
+}
+
+/**************************************************************************/
+/*!
+    @brief Sets the rotation of the display
+
+    @param[in]  r
+                The rotation, 0 to 3
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::setRotation(uint8_t r) {
+  Adafruit_GFX::setRotation(r);
+  forgetWhiteLines();
+
+  // Rows still to be cleared only mean the same in the new layout if that
+  // is all of them
+  bool cleared = _clearCount && (_clearCount == _bufferRows);
+  clearRows(0, _bufferRows);
+
+  if (_transposed && (rotation & 1)) {
+    // the buffer is kept in the orientation being drawn
+    _rawRotation = 0;
+    _rowBytes = stride(HEIGHT);
+    _bufferRows = WIDTH;
+  } else {
+    _rawRotation = _rotateOnRefresh ? (rotation & 1) : rotation;
+    _rowBytes = stride(WIDTH);
+    _bufferRows = HEIGHT;
+  }
+
+  if (cleared) {
+    memset(_clearRows, 0xff, (_bufferRows + 7) / 8);
+    _clearCount = _bufferRows;
+  }
+
+  for (uint8_t n = 0; _sprites && (n < SHARPMEM_SPRITES); n++) {
+    placeSprite(n);
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Moves the 180 degree part of the rotation from drawing to
+   refresh(). Rotation 2 then draws as fast as rotation 0 and rotation 3 as
+   fast as rotation 1, and refresh() sends the frame upside down.
+
+   The buffer is not converted, so set this before drawing. With it enabled
+   a change between rotation 0/1 and 2/3 turns the whole frame around at the
+   next refresh(), not just what is drawn afterwards. In rotations 2 and 3
+   the raw layout of copyPixelBuffer(), setBitmap() and setBackground() is
+   upside down.
+
+    @param[in]  enable
+                true to rotate while sending, false to rotate while drawing
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::setRotateOnRefresh(bool enable) {
+  _rotateOnRefresh = enable;
+  setRotation(rotation);
+}
+
+/**************************************************************************/
+/*!
+    @brief Mirrors the image on the panel. This is done by refresh() while
+   sending, the buffer and the drawing coordinates are not affected, so it
+   combines with any rotation.
+
+   A vertical mirror only changes which row is sent. A horizontal one reads
+   each byte of a row through a bit-reverse table instead of copying the
+   row. On a desktop, "make bench-run" in extras/test times mirrored frames
+   no slower than plain ones; on a board, either is small next to the 4 us
+   a byte takes on the wire at 2 MHz.
+
+    @param[in]  mirrorX
+                true to flip the panel image left to right
+    @param[in]  mirrorY
+                true to flip the panel image top to bottom
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::setMirror(bool mirrorX, bool mirrorY) {
+  _mirrorX = mirrorX;
+  _mirrorY = mirrorY;
+  forgetWhiteLines();
+}
+
+/**************************************************************************/
+/*!
+    @brief Drops the record of which panel lines are white, for when the way
+   buffer rows map to panel lines changes. An all white buffer stays known.
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::forgetWhiteLines(void) {
+  if (_whiteCount < HEIGHT) {
+    _whiteCount = 0;
+    if (_whiteLines) {
+      memset(_whiteLines, 0x00, (HEIGHT + 7) / 8);
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Fills the whole buffer with one color
+
+    @param color The color to fill with, white is tracked so refresh() can
+   send the clear command instead
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::fillScreen(uint16_t color) {
+  if (color == 1) {
+    clearDisplayBuffer();
+  } else {
+    fillRect(0, 0, _width, _height, color);
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Keeps the buffer in the drawing orientation in rotations 1 and 3,
+   so portrait drawing runs the same row kernels as landscape. refresh()
+   turns the buffer columns into panel lines with an 8x8 bit transpose, 8
+   lines at a time.
+
+   The buffer is not converted, so set this before drawing. With it enabled
+   a change between rotation 0/2 and 1/3 changes the buffer layout, redraw
+   everything afterwards. The raw layout of copyPixelBuffer(), setBitmap()
+   and setBackground() is then the drawing orientation too.
+
+    @param[in]  enable
+                true to store portrait rotations transposed
+    @return true on success, false if there was no memory for the line cache
+   or the panel width and height are not multiples of 8
+*/
+/**************************************************************************/
+bool Adafruit_SharpMem::setTransposedBuffer(bool enable) {
+  if (enable && !_lineCache) {
+    if ((WIDTH & 7) || (HEIGHT & 7)) {
+      return false;
+    }
+    _lineCache = (uint8_t *)malloc(WIDTH); // 8 lines of WIDTH / 8 bytes
+    if (!_lineCache) {
+      return false;
+    }
+  }
+  _transposed = enable;
+  _cachedGroup = -1;
+  setRotation(rotation);
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Pads every buffer row to a multiple of some number of bytes, so
+   code working on whole words of a row needs no special case at its end.
+   refresh() still sends the panel (WIDTH + 7) / 8 bytes per line. The
+   padding also applies to the raw layout of copyPixelBuffer(), setBitmap()
+   and setBackground().
+
+   After begin() the buffer is allocated again and cleared.
+
+    @param[in]  bytes
+                The row alignment, 1 for none, 4 for 32-bit words
+    @return true on success, false if there was no memory for the new buffer
+*/
+/**************************************************************************/
+bool Adafruit_SharpMem::setRowAlignment(uint8_t bytes) {
+  uint8_t old = _rowAlign;
+  _rowAlign = bytes ? bytes : 1;
+  if (!sharpmem_buffer) {
+    return true;
+  }
+
+  uint8_t *buffer = (uint8_t *)malloc(bufferBytes());
+  if (!buffer) {
+    _rowAlign = old;
+    return false;
+  }
+  free(sharpmem_buffer);
+  sharpmem_buffer = buffer;
+
+  // nothing in the old buffer is kept, so there is nothing left to clear
+  _clearCount = 0;
+  setRotation(rotation);
+  clearDisplayBuffer();
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Gets how many bytes a buffer row takes
+
+    @param[in]  pixels
+                How many pixels are in the row
+    @return The row size, padded to the row alignment
+*/
+/**************************************************************************/
+uint16_t Adafruit_SharpMem::stride(uint16_t pixels) {
+  uint16_t bytes = (pixels + 7) / 8;
+  return (bytes + _rowAlign - 1) / _rowAlign * _rowAlign;
+}
+
+/**************************************************************************/
+/*!
+    @brief Gets how big the buffer has to be for either of its layouts
+
+    @return The buffer size in bytes
+*/
+/**************************************************************************/
+uint32_t Adafruit_SharpMem::bufferBytes(void) {
+  uint32_t bytes = (uint32_t)stride(WIDTH) * HEIGHT;
+  if (!(WIDTH & 7) && !(HEIGHT & 7)) { // may be transposed
+    uint32_t transposed = (uint32_t)stride(HEIGHT) * WIDTH;
+    if (transposed > bytes) {
+      bytes = transposed;
+    }
+  }
+  return bytes;
+}
+
+/**************************************************************************/
+/*!
+    @brief Clears the display buffer without outputting to the display
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::clearDisplayBuffer() {
+  // Rows are only marked here; the first write to a row, or sending it,
+  // does the actual clearing
+  _clearCount = 0;
+  bufferChanged();
+  memset(_clearRows, 0xff, (_bufferRows + 7) / 8);
+  _clearCount = _bufferRows;
+  memset(_whiteLines, 0xff, (HEIGHT + 7) / 8);
+  _whiteCount = HEIGHT;
+}
+
+/**************************************************************************/
+/*!
+    @brief Clears the buffer rows in a range that clearDisplayBuffer() only
+   marked
+
+    @param[in]  y
+                The first buffer row
+    @param[in]  h
+                The number of rows
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::clearRows(int16_t y, int16_t h) {
+  for (int16_t i = y; _clearCount && (i < y + h); i++) {
+    if (_clearRows[i / 8] & set[i & 7]) {
+      memset(sharpmem_buffer + i * _rowBytes, 0xff, _rowBytes);
+      _clearRows[i / 8] &= clr[i & 7];
+      _clearCount--;
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief access to the raw display buffer
+
+    @param[out] bitmap
+                Where to copy the buffer to. Rotated, that is
+                (width() + 7) / 8 * height() bytes. Raw, it is
+                (WIDTH + 7) / 8 * HEIGHT bytes, more with padded rows, see
+                setRowAlignment().
+    @param[in]  rotated
+                false for the raw buffer layout, true for the orientation of
+                the current rotation, width() by height() pixels. The raw
+                layout is the panel orientation, except that it is the
+                drawing orientation in rotations 1 and 3 with
+                setTransposedBuffer(), and turned 180 degrees in rotations 2
+                and 3 with setRotateOnRefresh(). Mirroring never applies.
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::copyPixelBuffer(uint8_t *bitmap, bool rotated) {
+  clearRows(0, _bufferRows);
+  if (!rotated) {
+    memcpy(bitmap, sharpmem_buffer, _rowBytes * _bufferRows);
+    return;
+  }
+  // undo the rotation the buffer was drawn with, and the row padding
+  int16_t w = (_rawRotation & 1) ? _height : _width;
+  int16_t h = (_rawRotation & 1) ? _width : _height;
+  rotateBitmap(sharpmem_buffer, _rowBytes, w, h, bitmap, (_width + 7) / 8,
+               (4 - _rawRotation) & 3);
+}
+/**************************************************************************/
+/*!
+    @brief fills the display buffer with contents of bitmap without outputting
+   to the display
+
+    @param[in]  bitmap
+                The image, in the layout copyPixelBuffer() uses
+    @param[in]  rotated
+                false for the raw buffer layout, which copyPixelBuffer()
+                describes, true for the orientation of the current rotation,
+                width() by height() pixels
+*/
+/**************************************************************************/
+
+void Adafruit_SharpMem::setBitmap(uint8_t *bitmap, bool rotated) {
+  // every row gets overwritten anyway
+  _clearCount = 0;
+  memset(_clearRows, 0x00, (_bufferRows + 7) / 8);
+  bufferChanged();
+  if (!rotated) {
+    memcpy(sharpmem_buffer, bitmap, _rowBytes * _bufferRows);
+    return;
+  }
+  rotateBitmap(bitmap, (_width + 7) / 8, _width, _height, sharpmem_buffer,
+               _rowBytes, _rawRotation);
+}
+
+// Turns a negative size into the run the other way, ending at pos, as
+// fillRect() does for rectangles; false if that run starts before int16_t
+// does, where it is all off screen, or is 32768 long
+static bool flipSize(int16_t &pos, int16_t &len) {
+  if (len < 0) {
+    int32_t start = (int32_t)pos + len + 1;
+    if ((len == -32768) || (start < -32768)) {
+      return false;
+    }
+    pos = start;
+    len = -len;
+  }
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Fills a rectangle along the rows of the buffer, whatever the
+   rotation, so it always runs the horizontal kernel
+
+    @param[in]  x
+                The left edge
+    @param[in]  y
+                The top edge
+    @param[in]  w
+                The width
+    @param[in]  h
+                The height
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                                 uint16_t color) {
+  // Convert negative sizes to positive equivalents
+  if (!flipSize(x, w) || !flipSize(y, h) ||
+      !rawRect(x, y, w, h, _rawRotation)) {
+    SHARPMEM_STAT(clipped, 1);
+    return;
+  }
+
+  bufferChanged(x, y, w, h);
+  for (int16_t i = y; i < y + h; i++) {
+    writeRawHLine(x, i, w, color);
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Fills a circle row by row through the span path
+
+    @param[in]  x0
+                The center x position
+    @param[in]  y0
+                The center y position
+    @param[in]  r
+                The radius
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::fillCircle(int16_t x0, int16_t y0, int16_t r,
+                                   uint16_t color) {
+  int32_t d = 2 * (int32_t)r + 1;
+  if ((r < 0) || !beginSpans((int32_t)x0 - r, (int32_t)y0 - r, d, d)) {
+    return;
+  }
+  writeSpan((int32_t)x0 - r, y0, d, color);
+  circleSpans(x0, y0, r, 3, 0, color);
+}
+
+/**************************************************************************/
+/*!
+    @brief Fills the rows of the upper and/or lower half of a circle, without
+   its middle row
+
+    @param[in]  x0
+                The center x position
+    @param[in]  y0
+                The center y position
+    @param[in]  r
+                The radius
+    @param[in]  corners
+                1 for the lower half, 2 for the upper half
+    @param[in]  delta
+                How much wider to make every row, to the right
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::fillCircleHelper(int16_t x0, int16_t y0, int16_t r,
+                                         uint8_t corners, int16_t delta,
+                                         uint16_t color) {
+  if ((r < 0) || !beginSpans((int32_t)x0 - r, (int32_t)y0 - r,
+                             2 * (int32_t)r + delta + 1, 2 * (int32_t)r + 1)) {
+    return;
+  }
+  circleSpans(x0, y0, r, corners, delta, color);
+}
+
+/**************************************************************************/
+/*!
+    @brief Sends the rows of fillCircleHelper() to writeSpan(), after
+   beginSpans()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::circleSpans(int16_t x0, int16_t y0, int16_t r,
+                                    uint8_t corners, int16_t delta,
+                                    uint16_t color) {
+  // 32 bits, for radii up to the end of int16_t
+  int32_t f = 1 - (int32_t)r;
+  int32_t ddF_y = 1;
+  int32_t ddF_x = -2 * (int32_t)r;
+  int32_t y = 0;
+  int32_t x = r;
+  int32_t py = y;
+  int32_t px = x;
+  int32_t d = (int32_t)delta + 1; // Avoid some +1's in the loop
+
+  while (y < x) {
+    if (f >= 0) {
+      x--;
+      ddF_x += 2;
+      f += ddF_x;
+    }
+    y++;
+    ddF_y += 2;
+    f += ddF_y;
+    // These checks avoid double-drawing certain lines, important
+    // for the SSD1306 library which has an INVERT drawing mode.
+    if (y < (x + 1)) {
+      if (corners & 1)
+        writeSpan(x0 - x, y0 + y, 2 * x + d, color);
+      if (corners & 2)
+        writeSpan(x0 - x, y0 - y, 2 * x + d, color);
+    }
+    if (x != px) {
+      if (corners & 1)
+        writeSpan(x0 - py, y0 + px, 2 * py + d, color);
+      if (corners & 2)
+        writeSpan(x0 - py, y0 - px, 2 * py + d, color);
+      px = x;
+    }
+    py = y;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Fills an ellipse row by row through the span path. The rows come
+   from an integer walk of the outline whose error terms stay within 32 bits
+   up to a radius of SHARPMEM_MAX_ELLIPSE; larger ellipses are not drawn.
+
+    @param[in]  x0
+                The center x position
+    @param[in]  y0
+                The center y position
+    @param[in]  rx
+                The horizontal radius
+    @param[in]  ry
+                The vertical radius
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::fillEllipse(int16_t x0, int16_t y0, int16_t rx,
+                                    int16_t ry, uint16_t color) {
+  if ((rx < 0) || (ry < 0) || (rx > SHARPMEM_MAX_ELLIPSE) ||
+      (ry > SHARPMEM_MAX_ELLIPSE) ||
+      !beginSpans((int32_t)x0 - rx, (int32_t)y0 - ry, 2 * rx + 1,
+                  2 * ry + 1)) {
+    return;
+  }
+  // Walk one quarter of the outline from (-rx, 0) towards (0, ry), after
+  // A. Zingl's "A Rasterizing Algorithm for Drawing Curves". The first
+  // point of each row is the widest.
+  int16_t x = -rx;
+  int16_t y = 0;
+  int16_t row = -1; // the last row filled
+  int32_t aa = (int32_t)rx * rx;
+  int32_t bb = (int32_t)ry * ry;
+  int32_t err = x * (2 * bb + x) + bb; // error of the first step
+  int32_t e2;
+
+  do {
+    if (y != row) {
+      ellipseRow(x0, y0, -x, y, color);
+      row = y;
+    }
+    e2 = 2 * err;
+    if (e2 >= (x * 2 + 1) * bb) { // e_xy + e_x > 0
+      x++;
+      err += (x * 2 + 1) * bb;
+    }
+    if (e2 <= (y * 2 + 1) * aa) { // e_xy + e_y < 0
+      y++;
+      err += (y * 2 + 1) * aa;
+    }
+  } while (x <= 0);
+
+  // thin ellipses stop early, finish the tips
+  for (y = row + 1; y <= ry; y++) {
+    ellipseRow(x0, y0, 0, y, color);
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Fills a polygon one row at a time from a table of the edges that
+   cross the row, so shapes are filled without the overdraw of a triangle
+   fan. A pixel is filled when its center is inside, which leaves the right
+   and bottom outline out; polygons sharing an edge do not overlap.
+
+    @param[in]  points
+                The corners as x, y pairs, n * 2 values
+    @param[in]  n
+                The number of corners
+    @param color The color, as for drawPixel()
+    @param[in]  rule
+                SHARPMEM_FILL_EVEN_ODD or SHARPMEM_FILL_NONZERO, for where
+                the outline crosses itself
+    @return false if there was no memory for the edge table
+*/
+/**************************************************************************/
+bool Adafruit_SharpMem::fillPolygon(const int16_t *points, uint16_t n,
+                                    uint16_t color, uint8_t rule) {
+  if (n < 3) {
+    return true;
+  }
+
+  int16_t left = points[0], right = points[0];
+  int16_t top = points[1], bottom = points[1];
+  for (uint16_t i = 1; i < n; i++) {
+    int16_t x = points[2 * i], y = points[2 * i + 1];
+    left = (x < left) ? x : left;
+    right = (x > right) ? x : right;
+    top = (y < top) ? y : top;
+    bottom = (y > bottom) ? y : bottom;
+  }
+  if (!beginSpans(left, top, (int32_t)right - left, (int32_t)bottom - top)) {
+    return true;
+  }
+
+  // the pointers first, where they are aligned for themselves and for the
+  // edges after them
+  Edge **active = (Edge **)malloc(n * (sizeof(Edge *) + sizeof(Edge)));
+  if (!active) {
+    return false;
+  }
+  Edge *edges = (Edge *)(active + n);
+
+  // The edge table, sorted by top row; horizontal edges cross no rows
+  uint16_t count = 0;
+  for (uint16_t i = 0; i < n; i++) {
+    const int16_t *a = &points[2 * i];
+    const int16_t *b = &points[2 * ((i + 1) % n)];
+    if (a[1] == b[1]) {
+      continue;
+    }
+    int8_t dir = 1;
+    if (a[1] > b[1]) {
+      const int16_t *t = a;
+      a = b;
+      b = t;
+      dir = -1;
+    }
+
+    uint16_t j = count++;
+    for (; (j > 0) && (edges[j - 1].top > a[1]); j--) {
+      edges[j] = edges[j - 1];
+    }
+    Edge *e = &edges[j];
+    e->top = a[1];
+    e->bottom = b[1];
+    e->dy = (int32_t)b[1] - a[1];
+    e->x = a[0];
+    e->frac = 0;
+    e->step = ((int32_t)b[0] - a[0]) / e->dy;
+    e->rem = ((int32_t)b[0] - a[0]) % e->dy;
+    if (e->rem < 0) { // round the step down, not towards 0
+      e->step--;
+      e->rem += e->dy;
+    }
+    e->dir = dir;
+  }
+
+  int16_t first = (top > _spanTop) ? top : _spanTop;
+  int16_t last = (bottom < _spanBottom) ? bottom : _spanBottom;
+  uint16_t next = 0, live = 0;
+
+  for (int16_t y = first; y < last; y++) {
+    // bring in the edges that start by this row, moved down to it
+    for (; (next < count) && (edges[next].top <= y); next++) {
+      Edge *e = &edges[next];
+      if (e->bottom <= y) {
+        continue;
+      }
+      // rows and rem are both below dy, so only unsigned is wide enough
+      int32_t rows = y - e->top;
+      uint32_t frac = (uint32_t)rows * e->rem;
+      e->x += rows * e->step + (int32_t)(frac / e->dy);
+      e->frac = frac % e->dy;
+
+      // keep the active edges sorted by where they cross
+      uint16_t j = live++;
+      for (; (j > 0) && (active[j - 1]->x + (active[j - 1]->frac > 0) >
+                         e->x + (e->frac > 0));
+           j--) {
+        active[j] = active[j - 1];
+      }
+      active[j] = e;
+    }
+
+    int16_t inside = 0;
+    int32_t start = 0;
+    for (uint16_t i = 0; i < live; i++) {
+      Edge *e = active[i];
+      int32_t x = e->x + (e->frac > 0); // the first pixel center right of it
+      bool was = inside;
+      inside = (rule == SHARPMEM_FILL_NONZERO) ? inside + e->dir : !inside;
+      if (!was && inside) {
+        start = x;
+      } else if (was && !inside) {
+        writeSpan(start, y, x - start, color);
+      }
+    }
+
+    // step to the next row, dropping the edges that end and re-sorting
+    uint16_t kept = 0;
+    for (uint16_t i = 0; i < live; i++) {
+      Edge *e = active[i];
+      if (e->bottom <= y + 1) {
+        continue;
+      }
+      e->x += e->step;
+      e->frac += e->rem;
+      if (e->frac >= e->dy) {
+        e->x++;
+        e->frac -= e->dy;
+      }
+      uint16_t j = kept++;
+      for (; (j > 0) && (active[j - 1]->x + (active[j - 1]->frac > 0) >
+                         e->x + (e->frac > 0));
+           j--) {
+        active[j] = active[j - 1];
+      }
+      active[j] = e;
+    }
+    live = kept;
+  }
+
+  free(active);
+  return true;
+}
+
+// Moves from x in direction dir (1 or -1) while the pixels of a buffer row
+// are white, or black, a whole byte at a time where it can. Returns the
+// first pixel that is not, or x itself if it is already at or past end.
+static int16_t scanRun(const uint8_t *row, int16_t x, int16_t end, bool white,
+                       int8_t dir) {
+  uint8_t full = white ? 0xFF : 0x00;
+
+  while ((dir > 0) ? (x < end) : (x > end)) {
+    bool whole = (dir > 0) ? (!(x & 7) && (x + 8 <= end))
+                           : (((x & 7) == 7) && (x - 8 >= end));
+    if (whole && (row[x / 8] == full)) {
+      x += 8 * dir;
+      continue;
+    }
+    if (!(row[x / 8] & set[x & 7]) == white) {
+      return x;
+    }
+    x += dir;
+  }
+  return x;
+}
+
+/**************************************************************************/
+/*!
+    @brief Fills the area around a pixel that has the same color as it,
+   up to where that color ends (4-connected). It works on the buffer rows
+   with a fixed stack of pending spans, SHARPMEM_FLOOD_STACK of them.
+
+   A pattern color is filled as the opposite solid color first, and the
+   pattern drawn over the filled spans afterwards. Those are recorded in a
+   second fixed array, SHARPMEM_FLOOD_SPANS of them, so a convex area fits
+   whenever the buffer has no more rows than that. An area that needs more
+   is put back as it was and left unfilled. Both arrays are on the C stack
+   while the fill runs, 7 bytes a span on AVR: 2.2 KB with the defaults.
+
+    @param[in]  x
+                The x position to start at
+    @param[in]  y
+                The y position to start at
+    @param color The color, as for drawPixel()
+    @return false if the area could not be filled completely: the span stack
+   ran out or the record of filled spans did
+*/
+/**************************************************************************/
+bool Adafruit_SharpMem::floodFill(int16_t x, int16_t y, uint16_t color) {
+  int16_t w = 1, h = 1;
+  if (!rawRect(x, y, w, h, _rawRotation)) {
+    SHARPMEM_STAT(clipped, 1);
+    return true;
+  }
+  // the fill reads rows before it writes them
+  clearRows(0, _bufferRows);
+
+  // Flood fill does not care about the rotation, so it runs on the buffer
+  int16_t rowBytes = _rowBytes;
+  int16_t cols = (_transposed && (rotation & 1)) ? HEIGHT : WIDTH;
+  int16_t rows = _bufferRows;
+  bool white = sharpmem_buffer[x / 8 + y * rowBytes] & set[x & 7];
+  bool pattern = (color > 1) && (color < 8);
+  // a pattern is filled as the opposite color, which the scan can tell
+  // apart, then drawn over the spans that took
+  uint16_t fill = pattern ? !white : color;
+
+  if (!pattern && ((color != 0) == white)) {
+    return true; // already that color
+  }
+
+  FloodSpan stack[SHARPMEM_FLOOD_STACK];
+  FloodSpan filled[SHARPMEM_FLOOD_SPANS]; // for a pattern
+  uint16_t sp = 0, filledCount = 0;
+  bool overflow = false;
+  int16_t left = x, right = x, top = y, bottom = y;
+
+#define FLOOD_PUSH(Y, XL, XR, DY)                                              \
+  do {                                                                         \
+    if (((Y) + (DY) >= 0) && ((Y) + (DY) < rows)) {                            \
+      if (sp < SHARPMEM_FLOOD_STACK) {                                         \
+        stack[sp].y = (Y);                                                     \
+        stack[sp].xl = (XL);                                                   \
+        stack[sp].xr = (XR);                                                   \
+        stack[sp].dy = (DY);                                                   \
+        sp++;                                                                  \
+      } else {                                                                 \
+        overflow = true;                                                       \
+      }                                                                        \
+    }                                                                          \
+  } while (0)
+
+  // After P. Heckbert's seed fill in Graphics Gems: each span records a row
+  // that has been filled and the neighbouring row still to be looked at
+  FLOOD_PUSH(y, x, x, 1);
+  FLOOD_PUSH(y + 1, x, x, -1);
+
+  while (sp) {
+    sp--;
+    int8_t dy = stack[sp].dy;
+    int16_t l = stack[sp].xl;
+    int16_t r = stack[sp].xr;
+    int16_t ly = stack[sp].y + dy;
+    uint8_t *row = sharpmem_buffer + ly * rowBytes;
+    int16_t start, px;
+
+    if (!(row[l / 8] & set[l & 7]) != white) {
+      // the run goes on to the left of the span above; leaks back round
+      start = scanRun(row, l, -1, white, -1) + 1;
+      if (start < l) {
+        FLOOD_PUSH(ly, start, l - 1, -dy);
+      }
+      px = l;
+    } else {
+      px = scanRun(row, l, r + 1, !white, 1);
+      start = px;
+    }
+
+    while (px <= r) {
+      int16_t end = scanRun(row, px, cols, white, 1);
+      if (pattern && (filledCount == SHARPMEM_FLOOD_SPANS)) {
+        // out of room: put back the spans filled so far and give up
+        for (uint16_t i = 0; i < filledCount; i++) {
+          writeRawHLine(filled[i].xl, filled[i].y,
+                        filled[i].xr - filled[i].xl + 1, white);
+        }
+        return false;
+      }
+      writeRawHLine(start, ly, end - start, fill);
+      if (pattern) {
+        filled[filledCount].y = ly;
+        filled[filledCount].xl = start;
+        filled[filledCount].xr = end - 1;
+        filledCount++;
+      }
+      left = (start < left) ? start : left;
+      right = (end - 1 > right) ? end - 1 : right;
+      top = (ly < top) ? ly : top;
+      bottom = (ly > bottom) ? ly : bottom;
+
+      FLOOD_PUSH(ly, start, end - 1, dy);
+      if (end - 1 > r) { // leaks back round on the right
+        FLOOD_PUSH(ly, r + 1, end - 1, -dy);
+      }
+      px = scanRun(row, end, r + 1, !white, 1);
+      start = px;
+    }
+  }
+#undef FLOOD_PUSH
+
+  for (uint16_t i = 0; i < filledCount; i++) {
+    writeRawHLine(filled[i].xl, filled[i].y, filled[i].xr - filled[i].xl + 1,
+                  color);
+  }
+  bufferChanged(left, top, right - left + 1, bottom - top + 1);
+  return !overflow;
+}
+
+// sin() of 0-90 degrees, scaled by 1 << 14
+static const uint16_t sines[91] PROGMEM = {
+    0, 286, 572, 857, 1143, 1428, 1713, 1997, 2280, 2563, 2845, 3126, 3406,
+    3686, 3964, 4240, 4516, 4790, 5063, 5334, 5604, 5872, 6138, 6402, 6664,
+    6924, 7182, 7438, 7692, 7943, 8192, 8438, 8682, 8923, 9162, 9397, 9630,
+    9860, 10087, 10311, 10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982,
+    12176, 12365, 12551, 12733, 12911, 13085, 13255, 13421, 13583, 13741, 13894,
+    14044, 14189, 14330, 14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296,
+    15396, 15491, 15582, 15668, 15749, 15826, 15897, 15964, 16026, 16083, 16135,
+    16182, 16225, 16262, 16294, 16322, 16344, 16362, 16374, 16382, 16384};
+
+// The direction of an angle in degrees, clockwise from 12 o'clock, scaled
+// by 1 << 14
+static void direction(int16_t deg, int16_t &dx, int16_t &dy) {
+  deg %= 360;
+  if (deg < 0) {
+    deg += 360;
+  }
+  int16_t s = pgm_read_word(&sines[deg % 90]);
+  int16_t c = pgm_read_word(&sines[90 - deg % 90]);
+
+  // each quarter turn clockwise takes (x, y) to (-y, x)
+  switch (deg / 90) {
+  case 0:
+    dx = s;
+    dy = -c;
+    break;
+  case 1:
+    dx = c;
+    dy = s;
+    break;
+  case 2:
+    dx = -s;
+    dy = c;
+    break;
+  default:
+    dx = -c;
+    dy = -s;
+    break;
+  }
+}
+
+// a / b rounded down, for b > 0
+static int32_t floorDiv(int32_t a, int32_t b) {
+  return (a >= 0) ? a / b : -((b - 1 - a) / b);
+}
+
+// The x positions [lo, hi] on row y where a * y - b * x >= 0, which is one
+// side of a line through the origin
+static void halfRow(int32_t a, int32_t b, int16_t y, int32_t &lo,
+                    int32_t &hi) {
+  int32_t c = a * y;
+
+  lo = -32768;
+  hi = 32767;
+  if (b > 0) {
+    hi = floorDiv(c, b);
+  } else if (b < 0) {
+    lo = -floorDiv(c, -b);
+  } else if (c < 0) {
+    lo = 1;
+    hi = 0;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Fills a sector of a circle, or of a ring when it has an inner
+   radius, row by row through the span path. The outline comes from an
+   integer walk of both radii and the two edges from a table of sines, so
+   there is no floating point.
+
+    @param[in]  x0
+                The center x position
+    @param[in]  y0
+                The center y position
+    @param[in]  r
+                The outer radius
+    @param[in]  ir
+                The inner radius, 0 for a pie slice
+    @param[in]  start
+                The angle to start at in degrees, clockwise from 12 o'clock
+    @param[in]  end
+                The angle to end at, going clockwise; start + 360 for all of
+                the circle
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::fillArc(int16_t x0, int16_t y0, int16_t r, int16_t ir,
+                                int16_t start, int16_t end, uint16_t color) {
+  int32_t sweep = (int32_t)end - start;
+  if ((sweep > -360) && (sweep < 360)) {
+    sweep = (sweep + 360) % 360;
+  } else {
+    sweep = 360;
+  }
+  int32_t d = 2 * (int32_t)r + 1;
+  if ((r < 0) || (ir >= r) || !sweep ||
+      !beginSpans((int32_t)x0 - r, (int32_t)y0 - r, d, d)) {
+    return;
+  }
+
+  int16_t rays[4];
+  direction(start, rays[0], rays[1]);
+  direction(end, rays[2], rays[3]);
+
+  // a pixel is inside a radius when its center is within half a pixel of it
+  int32_t outerLimit = (int32_t)r * r + r;
+  int32_t innerLimit = (int32_t)ir * ir + ir;
+  int16_t outer = r;
+  int16_t inner = (ir > 0) ? ir : -1;
+
+  for (int32_t y = 0; y <= r; y++) { // 32 bits, r may be 32767
+    int32_t yy = y * y;
+    while ((int32_t)outer * outer + yy > outerLimit) {
+      outer--;
+    }
+    while ((inner >= 0) && ((int32_t)inner * inner + yy > innerLimit)) {
+      inner--;
+    }
+    arcRow(x0, y0, y, inner, outer, rays, sweep, color);
+    if (y) {
+      arcRow(x0, y0, -y, inner, outer, rays, sweep, color);
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Draws an arc of a circle with a stroke width, as a sector of a
+   ring that is strokeWidth wide inside the radius
+
+    @param[in]  x0
+                The center x position
+    @param[in]  y0
+                The center y position
+    @param[in]  r
+                The radius
+    @param[in]  start
+                The angle to start at in degrees, clockwise from 12 o'clock
+    @param[in]  end
+                The angle to end at, going clockwise
+    @param[in]  strokeWidth
+                The stroke width
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::drawArc(int16_t x0, int16_t y0, int16_t r,
+                                int16_t start, int16_t end,
+                                int16_t strokeWidth, uint16_t color) {
+  if (strokeWidth < 1) {
+    return;
+  }
+  fillArc(x0, y0, r, r - strokeWidth, start, end, color);
+}
+
+/**************************************************************************/
+/*!
+    @brief Draws a quadratic Bezier curve with a stroke width. The curve is
+   walked by integer forward differencing and stroked with a round brush,
+   through the span path.
+
+    @param[in]  x0
+                The start x position
+    @param[in]  y0
+                The start y position
+    @param[in]  x1
+                The control point x position
+    @param[in]  y1
+                The control point y position
+    @param[in]  x2
+                The end x position
+    @param[in]  y2
+                The end y position
+    @param[in]  strokeWidth
+                The stroke width
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::drawBezier(int16_t x0, int16_t y0, int16_t x1,
+                                   int16_t y1, int16_t x2, int16_t y2,
+                                   int16_t strokeWidth, uint16_t color) {
+  int16_t points[] = {x0, y0, x1, y1, x2, y2};
+  bezier(points, 2, strokeWidth, color);
+}
+
+/**************************************************************************/
+/*!
+    @brief Draws a cubic Bezier curve with a stroke width, like the
+   quadratic one
+
+    @param[in]  x0
+                The start x position
+    @param[in]  y0
+                The start y position
+    @param[in]  x1
+                The first control point x position
+    @param[in]  y1
+                The first control point y position
+    @param[in]  x2
+                The second control point x position
+    @param[in]  y2
+                The second control point y position
+    @param[in]  x3
+                The end x position
+    @param[in]  y3
+                The end y position
+    @param[in]  strokeWidth
+                The stroke width
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::drawBezier(int16_t x0, int16_t y0, int16_t x1,
+                                   int16_t y1, int16_t x2, int16_t y2,
+                                   int16_t x3, int16_t y3, int16_t strokeWidth,
+                                   uint16_t color) {
+  int16_t points[] = {x0, y0, x1, y1, x2, y2, x3, y3};
+  bezier(points, 3, strokeWidth, color);
+}
+
+// Bayer threshold map, 0-63; its even rows and columns are the 4x4 map
+static const uint8_t bayer[8][8] PROGMEM = {
+    {0, 32, 8, 40, 2, 34, 10, 42},  {48, 16, 56, 24, 50, 18, 58, 26},
+    {12, 44, 4, 36, 14, 46, 6, 38}, {60, 28, 52, 20, 62, 30, 54, 22},
+    {3, 35, 11, 43, 1, 33, 9, 41},  {51, 19, 59, 27, 49, 17, 57, 25},
+    {15, 47, 7, 39, 13, 45, 5, 37}, {63, 31, 55, 23, 61, 29, 53, 21}};
+
+/**************************************************************************/
+/*!
+    @brief Draws an 8-bit grayscale image, dithered to black and white. The
+   image is read a row at a time and each row goes into the buffer a byte
+   (8 pixels) at a time; when the rotation turns rows into buffer columns it
+   is a pixel at a time. Error diffusion keeps one row of error ahead, two
+   for Atkinson, and the thresholds follow the image, not the screen, so it
+   dithers the same wherever it is drawn.
+
+   As with drawBitmap() in Adafruit GFX, a const image is read from PROGMEM;
+   an image in RAM goes to the uint8_t * version.
+
+    @param[in]  x
+                The left edge
+    @param[in]  y
+                The top edge
+    @param[in]  img
+                The image in PROGMEM, w bytes per row, 0 is black and 255
+                white
+    @param[in]  w
+                The width of the image
+    @param[in]  h
+                The height of the image
+    @param[in]  method
+                SHARPMEM_DITHER_BAYER4, SHARPMEM_DITHER_BAYER8,
+                SHARPMEM_DITHER_FLOYD_STEINBERG or SHARPMEM_DITHER_ATKINSON
+    @return false if there was no memory for the error rows
+*/
+/**************************************************************************/
+bool Adafruit_SharpMem::drawGrayscaleDithered(int16_t x, int16_t y,
+                                              const uint8_t img[], int16_t w,
+                                              int16_t h, uint8_t method) {
+  return dither(x, y, img, w, h, method, true);
+}
+
+/**************************************************************************/
+/*!
+    @brief Draws an 8-bit grayscale image from RAM, dithered to black and
+   white, as the PROGMEM version does
+
+    @param[in]  x
+                The left edge
+    @param[in]  y
+                The top edge
+    @param[in]  img
+                The image in RAM, w bytes per row, 0 is black and 255 white
+    @param[in]  w
+                The width of the image
+    @param[in]  h
+                The height of the image
+    @param[in]  method
+                SHARPMEM_DITHER_BAYER4, SHARPMEM_DITHER_BAYER8,
+                SHARPMEM_DITHER_FLOYD_STEINBERG or SHARPMEM_DITHER_ATKINSON
+    @return false if there was no memory for the error rows
+*/
+/**************************************************************************/
+bool Adafruit_SharpMem::drawGrayscaleDithered(int16_t x, int16_t y,
+                                              uint8_t *img, int16_t w,
+                                              int16_t h, uint8_t method) {
+  return dither(x, y, img, w, h, method, false);
+}
+
+/**************************************************************************/
+/*!
+    @brief Dithers an image into the buffer for drawGrayscaleDithered()
+
+    @param[in]  x
+                The left edge
+    @param[in]  y
+                The top edge
+    @param[in]  img
+                The image, w bytes per row
+    @param[in]  w
+                The width of the image
+    @param[in]  h
+                The height of the image
+    @param[in]  method
+                The dither method
+    @param[in]  progmem
+                true if the image is in PROGMEM
+    @return false if there was no memory for the error rows
+*/
+/**************************************************************************/
+bool Adafruit_SharpMem::dither(int16_t x, int16_t y, const uint8_t *img,
+                               int16_t w, int16_t h, uint8_t method,
+                               bool progmem) {
+  int16_t rx = x, ry = y, rw = w, rh = h;
+  if ((w <= 0) || (h <= 0)) {
+    return true;
+  }
+  if (!rawRect(rx, ry, rw, rh, _rawRotation)) {
+    SHARPMEM_STAT(clipped, 1);
+    return true;
+  }
+
+  // the part on screen, in image coordinates
+  int16_t left = (x < 0) ? -x : 0;
+  int16_t right = (x + w > _width) ? _width - x : w;
+  int16_t top = (y < 0) ? -y : 0;
+  int16_t bottom = (y + h > _height) ? _height - y : h;
+
+  // error diffusion has to see the whole image up to the bottom of the screen
+  bool diffuse = (method == SHARPMEM_DITHER_FLOYD_STEINBERG) ||
+                 (method == SHARPMEM_DITHER_ATKINSON);
+  int16_t *err = NULL, *err2 = NULL;
+  if (diffuse) {
+    uint8_t rows = (method == SHARPMEM_DITHER_ATKINSON) ? 2 : 1;
+    err = (int16_t *)calloc((w + 1) * rows, sizeof(int16_t));
+    if (!err) {
+      return false;
+    }
+    err2 = err + w + 1; // two rows down, for Atkinson
+  }
+  bufferChanged(rx, ry, rw, rh);
+  SHARPMEM_STAT(pixels, (uint32_t)rw * rh);
+
+  for (int16_t j = diffuse ? 0 : top; j < bottom; j++) {
+    const uint8_t *src = img + (int32_t)j * w;
+    bool show = (j >= top);
+    uint8_t *ptr = NULL;
+    uint8_t bit = 0, bits = 0, mask = 0;
+
+    if (show) {
+      int16_t px = x + left, py = y + j;
+      switch (_rawRotation) {
+      case 1:
+        _swap_int16_t(px, py);
+        px = WIDTH - 1 - px;
+        break;
+      case 2:
+        px = WIDTH - 1 - px;
+        py = HEIGHT - 1 - py;
+        break;
+      case 3:
+        _swap_int16_t(px, py);
+        py = HEIGHT - 1 - py;
+        break;
+      }
+      ptr = &sharpmem_buffer[(px / 8) + py * _rowBytes];
+      bit = set[px & 7];
+    }
+
+    // err[i + 1] is the error for pixel i of this row until it is used, then
+    // for pixel i of the next row; the rest is carried along the row
+    int16_t ahead = 0, ahead2 = 0, below = 0;
+    if (err) {
+      err[0] = 0;
+    }
+
+    for (int16_t i = diffuse ? 0 : left; i < (diffuse ? w : right); i++) {
+      int16_t v = progmem ? pgm_read_byte(&src[i]) : src[i];
+      bool white;
+
+      if (method == SHARPMEM_DITHER_BAYER4) {
+        white = v > pgm_read_byte(&bayer[(j & 3) * 2][(i & 3) * 2]) * 16 + 8;
+      } else if (method == SHARPMEM_DITHER_BAYER8) {
+        white = v > pgm_read_byte(&bayer[j & 7][i & 7]) * 4 + 2;
+      } else {
+        v += err[i + 1] + ahead;
+        white = v > 127;
+        int16_t e = v - (white ? 255 : 0);
+        if (method == SHARPMEM_DITHER_ATKINSON) {
+          // 1/8 to two pixels ahead, three below and one two rows down
+          e /= 8;
+          ahead = ahead2 + e;
+          ahead2 = e;
+          err[i] += e;
+          err[i + 1] = err2[i + 1] + e + below;
+          below = e;
+          err2[i + 1] = e;
+        } else {
+          // 7/16 ahead, 3/16, 5/16 and 1/16 below
+          int16_t e7 = e * 7 / 16, e3 = e * 3 / 16, e5 = e * 5 / 16;
+          ahead = e7;
+          err[i] += e3;
+          err[i + 1] = e5 + below;
+          below = e - e7 - e3 - e5;
+        }
+      }
+
+      if (!show || (i < left) || (i >= right)) {
+        continue;
+      }
+      if (i > left) { // move along, storing each byte as it is finished
+        switch (_rawRotation) {
+        case 0:
+          bit <<= 1;
+          if (!bit) {
+            *ptr = (*ptr & ~mask) | bits;
+            bits = mask = 0;
+            ptr++;
+            bit = 0x01;
+          }
+          break;
+        case 2:
+          bit >>= 1;
+          if (!bit) {
+            *ptr = (*ptr & ~mask) | bits;
+            bits = mask = 0;
+            ptr--;
+            bit = 0x80;
+          }
+          break;
+        default:
+          *ptr = (*ptr & ~mask) | bits;
+          bits = mask = 0;
+          ptr += (_rawRotation == 1) ? _rowBytes : -_rowBytes;
+          break;
+        }
+      }
+      mask |= bit;
+      if (white) {
+        bits |= bit;
+      }
+    }
+    if (mask) {
+      *ptr = (*ptr & ~mask) | bits;
+    }
+  }
+
+  free(err);
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Fills the two rows of an ellipse at some distance from its center
+
+    @param[in]  x0
+                The center x position
+    @param[in]  y0
+                The center y position
+    @param[in]  x
+                Half the width of the rows
+    @param[in]  y
+                The distance of the rows from the center
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::ellipseRow(int16_t x0, int16_t y0, int16_t x, int16_t y,
+                                   uint16_t color) {
+  writeSpan((int32_t)x0 - x, (int32_t)y0 - y, 2 * x + 1, color);
+  if (y) {
+    writeSpan((int32_t)x0 - x, (int32_t)y0 + y, 2 * x + 1, color);
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Fills one row of fillArc(), after beginSpans()
+
+    @param[in]  x0
+                The center x position
+    @param[in]  y0
+                The center y position
+    @param[in]  y
+                The row, from the center
+    @param[in]  inner
+                How far the hole reaches on this row, -1 for none
+    @param[in]  outer
+                How far the circle reaches on this row
+    @param[in]  rays
+                The start and end directions, as x, y pairs
+    @param[in]  sweep
+                The angle between them, 360 for all of the circle
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::arcRow(int16_t x0, int16_t y0, int16_t y,
+                               int16_t inner, int16_t outer,
+                               const int16_t *rays, int16_t sweep,
+                               uint16_t color) {
+  int32_t lo[2] = {-32768, -32768};
+  int32_t hi[2] = {32767, 32767};
+  uint8_t sides = 1;
+
+  if (sweep < 360) {
+    // clockwise of the start and anticlockwise of the end
+    halfRow(rays[0], rays[1], y, lo[0], hi[0]);
+    halfRow(-rays[2], -rays[3], y, lo[1], hi[1]);
+    if (sweep <= 180) { // inside both
+      lo[0] = (lo[1] > lo[0]) ? lo[1] : lo[0];
+      hi[0] = (hi[1] < hi[0]) ? hi[1] : hi[0];
+    } else if ((lo[1] <= hi[0] + 1) && (lo[0] <= hi[1] + 1)) { // either
+      lo[0] = (lo[1] < lo[0]) ? lo[1] : lo[0];
+      hi[0] = (hi[1] > hi[0]) ? hi[1] : hi[0];
+    } else {
+      sides = 2;
+    }
+  }
+
+  // the ring is one run across the row, or two either side of the hole
+  int16_t from[2] = {(int16_t)-outer, (int16_t)(inner + 1)};
+  int16_t to[2] = {(int16_t)((inner < 0) ? outer : -inner - 1), outer};
+  uint8_t runs = (inner < 0) ? 1 : 2;
+
+  for (uint8_t i = 0; i < sides; i++) {
+    for (uint8_t j = 0; j < runs; j++) {
+      int32_t a = (from[j] > lo[i]) ? from[j] : lo[i];
+      int32_t b = (to[j] < hi[i]) ? to[j] : hi[i];
+      if (a <= b) {
+        writeSpan(x0 + a, (int32_t)y0 + y, b - a + 1, color);
+      }
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Strokes a Bezier curve of degree 2 or 3. The curve is scaled by
+   steps^3 so forward differencing stays exact in integers, and the pixel
+   position follows it one pixel at a time, so the brush never leaves a gap.
+
+    @param[in]  points
+                The end and control points as x, y pairs, degree + 1 of them
+    @param[in]  degree
+                2 or 3
+    @param[in]  strokeWidth
+                The stroke width
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::bezier(const int16_t *points, uint8_t degree,
+                               int16_t strokeWidth, uint16_t color) {
+  if (strokeWidth < 1) {
+    return;
+  }
+
+  int16_t left = points[0], right = points[0];
+  int16_t top = points[1], bottom = points[1];
+  int32_t steps = 1;
+  for (uint8_t i = 1; i <= degree; i++) {
+    int16_t x = points[2 * i], y = points[2 * i + 1];
+    left = (x < left) ? x : left;
+    right = (x > right) ? x : right;
+    top = (y < top) ? y : top;
+    bottom = (y > bottom) ? y : bottom;
+
+    // the curve moves at most degree times its longest leg, per unit of t
+    int32_t dx = abs((int32_t)x - points[2 * i - 2]);
+    int32_t dy = abs((int32_t)y - points[2 * i - 1]);
+    steps = (dx > steps) ? dx : steps;
+    steps = (dy > steps) ? dy : steps;
+  }
+  steps *= degree;
+  if (steps > SHARPMEM_MAX_CURVE_STEPS) {
+    steps = SHARPMEM_MAX_CURVE_STEPS;
+  }
+
+  // the box and the pen position in 32 bits, so that neither wraps for
+  // points near the ends of int16_t
+  int16_t pad = (strokeWidth - 1) / 2;
+  if (!beginSpans((int32_t)left - pad, (int32_t)top - pad,
+                  (int32_t)right - left + strokeWidth,
+                  (int32_t)bottom - top + strokeWidth)) {
+    return;
+  }
+
+  // P(t) = a t^3 + b t^2 + c t + p0, times n^3 at t = i / n
+  int64_t n = steps;
+  int64_t scale = n * n * n;
+  int64_t err[2], d1[2], d2[2], d3[2];
+  int32_t pos[2] = {points[0], points[1]};
+  for (uint8_t k = 0; k < 2; k++) {
+    int32_t p0 = points[k], p1 = points[2 + k], p2 = points[4 + k];
+    int32_t a, b, c;
+    if (degree == 2) {
+      a = 0;
+      b = p0 - 2 * p1 + p2;
+      c = 2 * (p1 - p0);
+    } else {
+      a = points[6 + k] - p0 + 3 * (p1 - p2);
+      b = 3 * (p0 - 2 * p1 + p2);
+      c = 3 * (p1 - p0);
+    }
+    err[k] = 0; // how far the curve is from pos, times n^3
+    d1[k] = a + b * n + c * n * n;
+    d2[k] = 6 * a + 2 * b * n;
+    d3[k] = 6 * a;
+  }
+
+  brushSpans(pos[0], pos[1], strokeWidth, color);
+  for (int32_t i = 0; i < steps; i++) {
+    for (uint8_t k = 0; k < 2; k++) {
+      err[k] += d1[k];
+      d1[k] += d2[k];
+      d2[k] += d3[k];
+    }
+    // catch up a pixel at a time, along the chord when steps is capped
+    for (;;) {
+      int64_t ax = (err[0] < 0) ? -err[0] : err[0];
+      int64_t ay = (err[1] < 0) ? -err[1] : err[1];
+      bool sx = (2 * ax > scale) && (2 * ax >= ay);
+      bool sy = (2 * ay > scale) && (2 * ay >= ax);
+      if (!sx && !sy) {
+        break;
+      }
+      if (sx) {
+        int8_t d = (err[0] > 0) ? 1 : -1;
+        pos[0] += d;
+        err[0] -= d * scale;
+      }
+      if (sy) {
+        int8_t d = (err[1] > 0) ? 1 : -1;
+        pos[1] += d;
+        err[1] -= d * scale;
+      }
+      brushSpans(pos[0], pos[1], strokeWidth, color);
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Stamps a round brush for the curves, after beginSpans()
+
+    @param[in]  x
+                The center x position, left of center when w is even
+    @param[in]  y
+                The center y position, above center when w is even
+    @param[in]  w
+                The diameter
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::brushSpans(int32_t x, int32_t y, int16_t w,
+                                   uint16_t color) {
+  // in half pixels from the middle: a row v out and u either side of it
+  int32_t limit = (int32_t)w * w;
+  int32_t u = w - 1;
+
+  x -= (w - 1) / 2;
+  y -= (w - 1) / 2;
+  for (int32_t v = (w - 1) & 1; v < w; v += 2) {
+    while (u * u + v * v > limit) {
+      u -= 2;
+    }
+    int32_t left = x + (w - 1 - u) / 2;
+    writeSpan(left, y + (w - 1 - v) / 2, u + 1, color);
+    if (v) {
+      writeSpan(left, y + (w - 1 + v) / 2, u + 1, color);
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Starts filling a shape span by span. Its bounding box is clipped
+   here once and marked changed, so writeSpan() only has to clip against
+   the box and can go straight to the raw kernels.
+
+    @param[in]  x
+                The left edge of the shape
+    @param[in]  y
+                The top edge of the shape
+    @param[in]  w
+                The width of the shape
+    @param[in]  h
+                The height of the shape
+    @return false if nothing of the shape is on screen
+
+    The box is taken in 32 bits, so the shapes can work out boxes that reach
+   past the range of int16_t.
+*/
+/**************************************************************************/
+bool Adafruit_SharpMem::beginSpans(int32_t x, int32_t y, int32_t w,
+                                   int32_t h) {
+  int32_t left = (x > 0) ? x : 0, top = (y > 0) ? y : 0;
+  int32_t right = (x + w < _width) ? x + w : _width;
+  int32_t bottom = (y + h < _height) ? y + h : _height;
+  if ((w <= 0) || (h <= 0) || (left >= right) || (top >= bottom)) {
+    SHARPMEM_STAT(clipped, 1);
+    return false;
+  }
+  _spanLeft = left;
+  _spanTop = top;
+  _spanRight = right;
+  _spanBottom = bottom;
+
+  // on screen now, so rawRect() only turns it into buffer coordinates
+  int16_t rx = left, ry = top, rw = right - left, rh = bottom - top;
+  rawRect(rx, ry, rw, rh, _rawRotation);
+  bufferChanged(rx, ry, rw, rh);
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Fills one row of a shape, after beginSpans()
+
+    @param[in]  x
+                The left end
+    @param[in]  y
+                The row
+    @param[in]  w
+                The length in pixels
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::writeSpan(int32_t x, int32_t y, int32_t w,
+                                  uint16_t color) {
+  if ((y < _spanTop) || (y >= _spanBottom)) {
+    return;
+  }
+  if (x < _spanLeft) {
+    w -= _spanLeft - x;
+    x = _spanLeft;
+  }
+  if (x + w > _spanRight) {
+    w = _spanRight - x;
+  }
+  if (w <= 0) {
+    return;
+  }
+
+  if (_rawRotation == 0) {
+    writeRawHLine(x, y, w, color);
+  } else if (_rawRotation == 1) {
+    writeRawVLine(WIDTH - 1 - y, x, w, color);
+  } else if (_rawRotation == 2) {
+    writeRawHLine(WIDTH - x - w, HEIGHT - 1 - y, w, color);
+  } else if (_rawRotation == 3) {
+    writeRawVLine(y, HEIGHT - x - w, w, color);
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Draws one column of a shape, after beginSpans(), the way
+   writeSpan() draws a row
+
+    @param[in]  x
+                The column
+    @param[in]  y
+                The top end
+    @param[in]  h
+                The length in pixels
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::writeColumn(int32_t x, int32_t y, int32_t h,
+                                    uint16_t color) {
+  if ((x < _spanLeft) || (x >= _spanRight)) {
+    return;
+  }
+  if (y < _spanTop) {
+    h -= _spanTop - y;
+    y = _spanTop;
+  }
+  if (y + h > _spanBottom) {
+    h = _spanBottom - y;
+  }
+  if (h <= 0) {
+    return;
+  }
+
+  if (_rawRotation == 0) {
+    writeRawVLine(x, y, h, color);
+  } else if (_rawRotation == 1) {
+    writeRawHLine(WIDTH - y - h, x, h, color);
+  } else if (_rawRotation == 2) {
+    writeRawVLine(WIDTH - 1 - x, HEIGHT - y - h, h, color);
+  } else if (_rawRotation == 3) {
+    writeRawHLine(y, HEIGHT - 1 - x, h, color);
+  }
+}
+
+/**************************************************************************/
+void Adafruit_SharpMem::drawFastHLine(int16_t x, int16_t y, int16_t w,
+                                      uint16_t color) {
+  if (w < 0) { // Convert negative widths to positive equivalent
+    w *= -1;
+    x -= w - 1;
+    if (x < 0) {
+      w += x;
+      x = 0;
+    }
+  }
+
+  // Edge rejection (no-draw if totally off canvas)
+  if ((y < 0) || (y >= height()) || (x >= width()) || ((x + w - 1) < 0)) {
+    SHARPMEM_STAT(clipped, 1);
+    return;
+  }
+
+  if (x < 0) { // Clip left
+    w += x;
+    x = 0;
+  }
+  if (x + w >= width()) { // Clip right
+    w = width() - x;
+  }
+
+  if (_rawRotation == 0) {
+    drawFastRawHLine(x, y, w, color);
+  } else if (_rawRotation == 1) {
+    int16_t t = x;
+    x = WIDTH - 1 - y;
+    y = t;
+    drawFastRawVLine(x, y, w, color);
+  } else if (_rawRotation == 2) {
+    x = WIDTH - 1 - x;
+    y = HEIGHT - 1 - y;
+
+    x -= w - 1;
+    drawFastRawHLine(x, y, w, color);
+  } else if (_rawRotation == 3) {
+    int16_t t = x;
+    x = y;
+    y = HEIGHT - 1 - t;
+    y -= w - 1;
+    drawFastRawVLine(x, y, w, color);
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Draws a vertical line, clipped once and sent to the raw kernel
+   that draws it in the buffer orientation
+
+    @param[in]  x
+                The x position
+    @param[in]  y
+                The top end, or the bottom end if h is negative
+    @param[in]  h
+                The length in pixels
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::drawFastVLine(int16_t x, int16_t y, int16_t h,
+                                      uint16_t color) {
+  if (h < 0) { // Convert negative heights to positive equivalent
+    h *= -1;
+    y -= h - 1;
+  }
+
+  // Edge rejection (no-draw if totally off canvas)
+  if (!h || (x < 0) || (x >= width()) || (y >= height()) ||
+      ((y + h - 1) < 0)) {
+    SHARPMEM_STAT(clipped, 1);
+    return;
+  }
+
+  if (y < 0) { // Clip top
+    h += y;
+    y = 0;
+  }
+  if (y + h >= height()) { // Clip bottom
+    h = height() - y;
+  }
+
+  if (_rawRotation == 0) {
+    drawFastRawVLine(x, y, h, color);
+  } else if (_rawRotation == 1) {
+    drawFastRawHLine(WIDTH - y - h, x, h, color);
+  } else if (_rawRotation == 2) {
+    drawFastRawVLine(WIDTH - 1 - x, HEIGHT - y - h, h, color);
+  } else if (_rawRotation == 3) {
+    drawFastRawHLine(y, HEIGHT - 1 - x, h, color);
+  }
+}
+
+// Moves a buffer position one pixel along x, by shifting the bit mask, or
+// along y, by a row
+static inline void stepPixel(uint8_t *&ptr, uint8_t &mask, int16_t &row,
+                             int8_t bits, int8_t rows, int16_t rowBytes) {
+  if (bits > 0) {
+    mask <<= 1;
+    if (!mask) {
+      mask = 0x01;
+      ptr++;
+    }
+  } else if (bits < 0) {
+    mask >>= 1;
+    if (!mask) {
+      mask = 0x80;
+      ptr--;
+    }
+  }
+  if (rows) {
+    ptr += rows * rowBytes;
+    row += rows;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Draws a line with the pixels of the Adafruit_GFX version. Lines
+   along an axis go to the span kernels. Others are clipped once, by working
+   out which Bresenham steps land on screen, and then walked as a buffer
+   pointer and bit mask in raw coordinates.
+
+    @param[in]  x0
+                The x position of one end
+    @param[in]  y0
+                The y position of one end
+    @param[in]  x1
+                The x position of the other end
+    @param[in]  y1
+                The y position of the other end
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::writeLine(int16_t x0, int16_t y0, int16_t x1,
+                                  int16_t y1, uint16_t color) {
+  // The ends may be up to 65535 apart, so the distances are 32 bits. Lines
+  // along an axis are cut to just past the screen first, which keeps their
+  // length within int16_t.
+  int32_t lo, hi;
+  if (x0 == x1) {
+    lo = (y0 < y1) ? y0 : y1;
+    hi = (y0 < y1) ? y1 : y0;
+    lo = (lo > -1) ? lo : -1;
+    hi = (hi < _height) ? hi : _height;
+    drawFastVLine(x0, lo, hi - lo + 1, color);
+    return;
+  }
+  if (y0 == y1) {
+    lo = (x0 < x1) ? x0 : x1;
+    hi = (x0 < x1) ? x1 : x0;
+    lo = (lo > -1) ? lo : -1;
+    hi = (hi < _width) ? hi : _width;
+    drawFastHLine(lo, y0, hi - lo + 1, color);
+    return;
+  }
+
+  int32_t adx = (x0 < x1) ? (int32_t)x1 - x0 : (int32_t)x0 - x1;
+  int32_t ady = (y0 < y1) ? (int32_t)y1 - y0 : (int32_t)y0 - y1;
+  bool steep = ady > adx;
+  if (steep) {
+    _swap_int16_t(x0, y0);
+    _swap_int16_t(x1, y1);
+  }
+  if (x0 > x1) {
+    _swap_int16_t(x0, x1);
+    _swap_int16_t(y0, y1);
+  }
+
+  int32_t dx = steep ? ady : adx;
+  int32_t dy = steep ? adx : ady;
+  int32_t half = dx / 2;
+  int8_t ystep = (y0 < y1) ? 1 : -1;
+  int16_t majorEnd = steep ? _height : _width;
+  int16_t minorEnd = steep ? _width : _height;
+
+  // Step i is drawn at (x0 + i, y0 + ystep * k), where k counts how often
+  // the error wrapped: 0 while i * dy <= half, else
+  // ceil((i * dy - half) / dx). Clip i against both axes with that. The
+  // products are of two distances, which fit in 32 bits unsigned.
+  int32_t first = (x0 < 0) ? -(int32_t)x0 : 0;
+  int32_t last = (x1 >= majorEnd) ? (int32_t)majorEnd - 1 - x0 : dx;
+  int32_t kLow = (ystep > 0) ? -(int32_t)y0 : (int32_t)y0 - (minorEnd - 1);
+  int32_t kHigh = (ystep > 0) ? (int32_t)minorEnd - 1 - y0 : y0;
+  if ((kHigh < 0) || (kLow > dy)) {
+    SHARPMEM_STAT(clipped, 1);
+    return;
+  }
+  if (kLow > 0) { // the first step with k >= kLow
+    int32_t i = ((uint32_t)(kLow - 1) * dx + half) / dy + 1;
+    if (i > first) {
+      first = i;
+    }
+  }
+  if (kHigh < dy) { // the last step with k <= kHigh
+    int32_t i = ((uint32_t)kHigh * dx + half) / dy;
+    if (i < last) {
+      last = i;
+    }
+  }
+  if (first > last) {
+    SHARPMEM_STAT(clipped, 1);
+    return;
+  }
+
+  uint32_t firstDy = (uint32_t)first * dy, lastDy = (uint32_t)last * dy;
+  int32_t k = (firstDy > (uint32_t)half) ? (firstDy - half + dx - 1) / dx : 0;
+  int32_t kEnd = (lastDy > (uint32_t)half) ? (lastDy - half + dx - 1) / dx : 0;
+  int32_t err = (int32_t)(half + (uint32_t)k * dx - firstDy);
+
+  // The clipped ends in drawing coordinates, and the screen direction of
+  // a step along each axis
+  int16_t ax = x0 + first, ay = y0 + ystep * k;
+  int16_t bx = x0 + last, by = y0 + ystep * kEnd;
+  int8_t majorX = 1, majorY = 0, minorX = 0, minorY = ystep;
+  if (steep) {
+    _swap_int16_t(ax, ay);
+    _swap_int16_t(bx, by);
+    majorX = 0;
+    majorY = 1;
+    minorX = ystep;
+    minorY = 0;
+  }
+
+  // the bounding box goes through rawRect(), which clips it and changes it
+  // to buffer coordinates; the start pixel goes the way drawPixel() does it
+  int16_t bx0 = (ax < bx) ? ax : bx, by0 = (ay < by) ? ay : by;
+  int16_t bw = abs(bx - ax) + 1, bh = abs(by - ay) + 1;
+  rawRect(bx0, by0, bw, bh, _rawRotation);
+  bufferChanged(bx0, by0, bw, bh);
+  SHARPMEM_STAT(pixels, last - first + 1);
+
+  int8_t t;
+  switch (_rawRotation) {
+  case 1:
+    _swap_int16_t(ax, ay);
+    ax = WIDTH - 1 - ax;
+    t = majorX;
+    majorX = -majorY;
+    majorY = t;
+    t = minorX;
+    minorX = -minorY;
+    minorY = t;
+    break;
+  case 2:
+    ax = WIDTH - 1 - ax;
+    ay = HEIGHT - 1 - ay;
+    majorX = -majorX;
+    majorY = -majorY;
+    minorX = -minorX;
+    minorY = -minorY;
+    break;
+  case 3:
+    _swap_int16_t(ax, ay);
+    ay = HEIGHT - 1 - ay;
+    t = majorX;
+    majorX = majorY;
+    majorY = -t;
+    t = minorX;
+    minorX = minorY;
+    minorY = -t;
+    break;
+  }
+
+  int16_t rowBytes = _rowBytes;
+  uint8_t *ptr = &sharpmem_buffer[(ax / 8) + ay * rowBytes];
+  uint8_t mask = set[ax & 7];
+  int16_t row = ay;
+  bool solid = (color < 2) || (color > 7);
+  uint8_t pattern = patternByte(color, row);
+
+  for (int32_t i = first;; i++) {
+    if (!solid) {
+      pattern = patternByte(color, row);
+    }
+    if (pattern & mask) {
+      *ptr |= mask;
+    } else {
+      *ptr &= ~mask;
+    }
+    if (i == last) {
+      break;
+    }
+    err -= dy;
+    if (err < 0) {
+      stepPixel(ptr, mask, row, minorX, minorY, rowBytes);
+      err += dx;
+    }
+    stepPixel(ptr, mask, row, majorX, majorY, rowBytes);
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Draws a line through writeLine(). GFX sends lines along an axis
+   to drawFastHLine() and drawFastVLine() with a length worked out in
+   int16_t, which wraps when the ends are more than 32767 apart.
+
+    @param[in]  x0
+                The x position of one end
+    @param[in]  y0
+                The y position of one end
+    @param[in]  x1
+                The x position of the other end
+    @param[in]  y1
+                The y position of the other end
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::drawLine(int16_t x0, int16_t y0, int16_t x1,
+                                 int16_t y1, uint16_t color) {
+  writeLine(x0, y0, x1, y1, color);
+}
+
+/**************************************************************************/
+/*!
+    @brief Draws a rectangle outline: two horizontal runs and two vertical
+   ones, without drawing the corners twice. A negative width or height goes
+   left or up from x, y, as for fillRect().
+
+    @param[in]  x
+                The left edge
+    @param[in]  y
+                The top edge
+    @param[in]  w
+                The width
+    @param[in]  h
+                The height
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::drawRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                                 uint16_t color) {
+  if (!flipSize(x, w) || !flipSize(y, h) || (w == 0) || (h == 0) ||
+      (x >= width()) || (y >= height()) || ((int32_t)x + w <= 0) ||
+      ((int32_t)y + h <= 0)) {
+    SHARPMEM_STAT(clipped, 1);
+    return;
+  }
+
+  drawFastHLine(x, y, w, color);
+  if (h > 1) {
+    drawFastHLine(x, y + h - 1, w, color);
+  }
+  if (h > 2) {
+    drawFastVLine(x, y + 1, h - 2, color);
+    if (w > 1) {
+      drawFastVLine(x + w - 1, y + 1, h - 2, color);
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Draws a circle outline. It has the pixels of the Adafruit_GFX
+   version, clipped once and drawn as horizontal runs near the top and
+   bottom and as vertical runs along the sides.
+
+    @param[in]  x0
+                The center x position
+    @param[in]  y0
+                The center y position
+    @param[in]  r
+                The radius
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::drawCircle(int16_t x0, int16_t y0, int16_t r,
+                                   uint16_t color) {
+  if (r < 0) {
+    SHARPMEM_STAT(clipped, 1);
+    return;
+  }
+  circleOutline(x0, y0, r, 0xF, true, color);
+}
+
+/**************************************************************************/
+/*!
+    @brief Draws quarters of a circle outline, as Adafruit_GFX does for
+   rounded rectangles: without the pixels on the axes
+
+    @param[in]  x0
+                The center x position
+    @param[in]  y0
+                The center y position
+    @param[in]  r
+                The radius
+    @param[in]  cornername
+                Which quarters: 1 upper left, 2 upper right, 4 lower right,
+                8 lower left
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::drawCircleHelper(int16_t x0, int16_t y0, int16_t r,
+                                         uint8_t cornername, uint16_t color) {
+  circleOutline(x0, y0, r, cornername, false, color);
+}
+
+/**************************************************************************/
+/*!
+    @brief Walks a circle outline and draws it one run of pixels at a time,
+   after clipping the quarters it draws once with beginSpans()
+
+    @param[in]  x0
+                The center x position
+    @param[in]  y0
+                The center y position
+    @param[in]  r
+                The radius
+    @param[in]  corners
+                Which quarters, as for drawCircleHelper()
+    @param[in]  axes
+                true to include the pixels on the axes
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::circleOutline(int16_t x0, int16_t y0, int16_t r,
+                                      uint8_t corners, bool axes,
+                                      uint16_t color) {
+  // 32 bits, for radii up to the end of int16_t
+  int32_t left = (corners & 9) ? (int32_t)x0 - r : x0;
+  int32_t right = (corners & 6) ? (int32_t)x0 + r : x0;
+  int32_t top = (corners & 3) ? (int32_t)y0 - r : y0;
+  int32_t bottom = (corners & 12) ? (int32_t)y0 + r : y0;
+  if (!beginSpans(left, top, right - left + 1, bottom - top + 1)) {
+    return;
+  }
+
+  int32_t f = 1 - (int32_t)r;
+  int32_t ddF_x = 1;
+  int32_t ddF_y = -2 * (int32_t)r;
+  int32_t x = 0;
+  int32_t y = r;
+  int32_t start = axes ? 0 : 1; // where the run at height y begins
+
+  while (x < y) {
+    if (f >= 0) {
+      // y is about to change, so the run at this height is complete
+      if (x >= start) {
+        circleRun(x0, y0, y, start, x, corners, color);
+      }
+      start = x + 1;
+      y--;
+      ddF_y += 2;
+      f += ddF_y;
+    }
+    x++;
+    ddF_x += 2;
+    f += ddF_x;
+  }
+  if (x >= start) {
+    circleRun(x0, y0, y, start, x, corners, color);
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Draws one run of a circle outline in each of the quarters, once
+   mirrored to the top or bottom and once to the sides, after beginSpans()
+
+    @param[in]  x0
+                The center x position
+    @param[in]  y0
+                The center y position
+    @param[in]  y
+                The distance of the run from the center
+    @param[in]  from
+                Where the run starts along it
+    @param[in]  to
+                Where it ends
+    @param[in]  corners
+                Which quarters, as for drawCircleHelper()
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::circleRun(int16_t x0, int16_t y0, int32_t y,
+                                  int32_t from, int32_t to, uint8_t corners,
+                                  uint16_t color) {
+  int32_t len = to - from + 1;
+
+  if ((from == 0) && (corners == 0xF)) { // one run across each axis
+    writeSpan(x0 - to, y0 - y, 2 * to + 1, color);
+    writeSpan(x0 - to, y0 + y, 2 * to + 1, color);
+    writeColumn(x0 - y, y0 - to, 2 * to + 1, color);
+    writeColumn(x0 + y, y0 - to, 2 * to + 1, color);
+    return;
+  }
+
+  for (uint8_t c = 0; c < 4; c++) {
+    if (!(corners & set[c])) {
+      continue;
+    }
+    bool right = (c == 1) || (c == 2);
+    bool lower = (c >= 2);
+    writeSpan(right ? x0 + from : x0 - to, lower ? y0 + y : y0 - y, len,
+              color);
+    writeColumn(right ? x0 + y : x0 - y, lower ? y0 + from : y0 - to, len,
+                color);
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Draws a rounded rectangle outline from runs of pixels. Negative
+   sizes go left or up from x, y, as for drawRect().
+
+    @param[in]  x
+                The left edge
+    @param[in]  y
+                The top edge
+    @param[in]  w
+                The width
+    @param[in]  h
+                The height
+    @param[in]  r
+                The corner radius, at most half the shorter side
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::drawRoundRect(int16_t x, int16_t y, int16_t w,
+                                      int16_t h, int16_t r, uint16_t color) {
+  if (!flipSize(x, w) || !flipSize(y, h) || (w == 0) || (h == 0) ||
+      (x >= width()) || (y >= height()) || ((int32_t)x + w <= 0) ||
+      ((int32_t)y + h <= 0)) {
+    SHARPMEM_STAT(clipped, 1);
+    return;
+  }
+  int16_t max_radius = ((w < h) ? w : h) / 2; // 1/2 minor axis
+  if (r > max_radius) {
+    r = max_radius;
+  }
+
+  drawFastHLine(x + r, y, w - 2 * r, color);         // Top
+  drawFastHLine(x + r, y + h - 1, w - 2 * r, color); // Bottom
+  drawFastVLine(x, y + r, h - 2 * r, color);         // Left
+  drawFastVLine(x + w - 1, y + r, h - 2 * r, color); // Right
+  circleOutline(x + r, y + r, r, 1, false, color);
+  circleOutline(x + w - r - 1, y + r, r, 2, false, color);
+  circleOutline(x + w - r - 1, y + h - r - 1, r, 4, false, color);
+  circleOutline(x + r, y + h - r - 1, r, 8, false, color);
+}
+
+/**************************************************************************/
+/*!
+    @brief Fills a rounded rectangle one row at a time. Negative sizes go
+   left or up from x, y, as for drawRect().
+
+    @param[in]  x
+                The left edge
+    @param[in]  y
+                The top edge
+    @param[in]  w
+                The width
+    @param[in]  h
+                The height
+    @param[in]  r
+                The corner radius, at most half the shorter side
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::fillRoundRect(int16_t x, int16_t y, int16_t w,
+                                      int16_t h, int16_t r, uint16_t color) {
+  if (!flipSize(x, w) || !flipSize(y, h) || (w == 0) || (h == 0) ||
+      (x >= width()) || (y >= height()) || ((int32_t)x + w <= 0) ||
+      ((int32_t)y + h <= 0)) {
+    SHARPMEM_STAT(clipped, 1);
+    return;
+  }
+  int16_t max_radius = ((w < h) ? w : h) / 2; // 1/2 minor axis
+  if (r > max_radius) {
+    r = max_radius;
+  }
+
+  // the straight middle, then the rounded rows above and below it
+  fillRect(x, y + r, w, h - 2 * r, color);
+  fillCircleHelper(x + r, y + r, r, 2, w - 2 * r - 1, color);
+  fillCircleHelper(x + r, y + h - r - 1, r, 1, w - 2 * r - 1, color);
+}
+
+/**************************************************************************/
+void Adafruit_SharpMem::drawFastRawVLine(int16_t x, int16_t y, int16_t h,
+                                         uint16_t color) {
+  bufferChanged(x, y, 1, h);
+  writeRawVLine(x, y, h, color);
+}
+
+/**************************************************************************/
+/*!
+    @brief Draws a vertical line in raw (rotation 0) coordinates, for callers
+   that have already clipped it and called bufferChanged()
+
+    @param[in]  x
+                The raw x position
+    @param[in]  y
+                The raw top end
+    @param[in]  h
+                The length in pixels
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::writeRawVLine(int16_t x, int16_t y, int16_t h,
+                                      uint16_t color) {
+  // x & y already in raw (rotation 0) coordinates, no need to transform.
+  int16_t row_bytes = _rowBytes;
+  SHARPMEM_STAT(vLines, 1);
+  SHARPMEM_STAT(vLinePixels, h);
+  uint8_t *ptr = &sharpmem_buffer[(x / 8) + y * row_bytes];
+
+  uint8_t bit_mask = set[x & 7]; // CHANGED
+
+  if ((color > 1) && (color < 8)) { // a pattern, bit by bit
+    for (int16_t i = 0; i < h; i++) {
+      if (patternByte(color, y + i) & bit_mask) {
+        *ptr |= bit_mask;
+      } else {
+        *ptr &= ~bit_mask;
+      }
+      ptr += row_bytes;
+    }
+  } else if (color > 0) {
+    for (int16_t i = 0; i < h; i++) {
+      *ptr |= bit_mask;
+      ptr += row_bytes;
+    }
+  } else { // BLACK
+    bit_mask = ~bit_mask;
+    for (int16_t i = 0; i < h; i++) {
+      *ptr &= bit_mask;
+      ptr += row_bytes;
     }
   }
 }
@@ -532,10 +3543,33 @@ void Adafruit_SharpMem::drawFastRawVLine(int16_t x, int16_t y, int16_t h,
 /**************************************************************************/
 void Adafruit_SharpMem::drawFastRawHLine(int16_t x, int16_t y, int16_t w,
                                          uint16_t color) {
+  bufferChanged(x, y, w, 1);
+  writeRawHLine(x, y, w, color);
+}
+
+/**************************************************************************/
+/*!
+    @brief Draws a horizontal line in raw (rotation 0) coordinates, for
+   callers that have already clipped it and called bufferChanged()
+
+    @param[in]  x
+                The raw left end
+    @param[in]  y
+                The raw y position
+    @param[in]  w
+                The length in pixels
+    @param color The color, as for drawPixel()
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::writeRawHLine(int16_t x, int16_t y, int16_t w,
+                                      uint16_t color) {
   // x & y already in raw (rotation 0) coordinates, no need to transform.
-  int16_t rowBytes = ((WIDTH + 7) / 8);
+  int16_t rowBytes = _rowBytes;
+  SHARPMEM_STAT(hLines, 1);
+  SHARPMEM_STAT(hLinePixels, w);
   uint8_t *ptr = &sharpmem_buffer[(x / 8) + y * rowBytes];
   size_t remainingWidthBits = w;
+  uint8_t pattern = patternByte(color, y);
 
   // check to see if first byte needs to be partially filled
   if ((x & 7) > 0) {
@@ -546,88 +3580,7 @@ void Adafruit_SharpMem::drawFastRawHLine(int16_t x, int16_t y, int16_t w,
       remainingWidthBits--;
     }
 
-    if (color == 7) {
-      uint8_t pattern = 0x00;
-      switch (y % 4) {
-      case 0:
-        pattern = 0x77;
-        break;
-      case 1:
-        pattern = 0xBB;
-        break;
-      case 2:
-        pattern = 0xDD;
-        break;
-      case 3:
-        pattern = 0xEE;
-        break;
-      }
-      *ptr &= ~(startByteBitMask & ~pattern);
-      *ptr |= startByteBitMask & pattern;
-    } else if (color == 6) {
-      uint8_t pattern = 0x00;
-      switch (y % 4) {
-      case 0:
-        pattern = 0xEE;
-        break;
-      case 1:
-        pattern = 0xDD;
-        break;
-      case 2:
-        pattern = 0xBB;
-        break;
-      case 3:
-        pattern = 0x77;
-        break;
-      }
-      *ptr &= ~(startByteBitMask & ~pattern);
-      *ptr |= startByteBitMask & pattern;
-    } else if (color == 5) {
-      uint8_t pattern = 0x00;
-      switch (y % 4) {
-      case 0: // 0x11
-        pattern = 0xEE;
-        break;
-      case 1: // 0x22
-        pattern = 0x55;
-        break;
-      case 2: // 0xBB
-        pattern = 0xBB;
-        break;
-      case 3: // 0x88
-        pattern = 0x55;
-        break;
-      }
-      *ptr &= ~(startByteBitMask & ~pattern);
-      *ptr |= startByteBitMask & pattern;
-    } else if (color == 4) { // LIGHT GRAY
-      if (y % 2 != 0) {      // off
-        *ptr |= startByteBitMask;
-      } else { // on every other pixel
-        *ptr &= ~(startByteBitMask & ~0x55);
-        *ptr |= startByteBitMask & 0x55;
-      }
-    } else if (color == 3) { // DARK GRAY
-      if (y % 2 != 0) {      // off
-        *ptr &= ~startByteBitMask;
-      } else { // on every other pixel
-        *ptr &= ~(startByteBitMask & ~0xAA);
-        *ptr |= startByteBitMask & 0xAA;
-      }
-    } else if (color == 2) { // GRAY
-      if (y % 2 == 0) {
-        *ptr &= ~(startByteBitMask & ~0xAA);
-        *ptr |= startByteBitMask & 0xAA;
-      } else {
-        *ptr &= ~(startByteBitMask & ~0x55);
-        *ptr |= startByteBitMask & 0x55;
-      }
-    } else if (color == 1) { // white
-      *ptr |= startByteBitMask;
-    } else { // black
-      *ptr &= ~startByteBitMask;
-    }
-
+    *ptr = (*ptr & ~startByteBitMask) | (pattern & startByteBitMask);
     ptr++;
   }
 
@@ -635,74 +3588,8 @@ void Adafruit_SharpMem::drawFastRawHLine(int16_t x, int16_t y, int16_t w,
   if (remainingWidthBits > 0) {
     size_t remainingWholeBytes = remainingWidthBits / 8;
     size_t lastByteBits = remainingWidthBits % 8;
-    uint8_t wholeByteColor = color > 0 ? 0xFF : 0x00;
-
-    if (color == 7) {
-      switch (y % 4) {
-      case 0:
-        wholeByteColor = 0x77;
-        break;
-      case 1:
-        wholeByteColor = 0xBB;
-        break;
-      case 2:
-        wholeByteColor = 0xDD;
-        break;
-      case 3:
-        wholeByteColor = 0xEE;
-        break;
-      }
-    } else if (color == 6) {
-      switch (y % 4) {
-      case 0:
-        wholeByteColor = 0xEE;
-        break;
-      case 1:
-        wholeByteColor = 0xDD;
-        break;
-      case 2:
-        wholeByteColor = 0xBB;
-        break;
-      case 3:
-        wholeByteColor = 0x77;
-        break;
-      }
-    } else if (color == 5) {
-      switch (y % 4) {
-      case 0: // 0x11
-        wholeByteColor = 0xEE;
-        break;
-      case 1: // 0x22
-        wholeByteColor = 0x55;
-        break;
-      case 2: // 0xBB
-        wholeByteColor = 0xBB;
-        break;
-      case 3: // 0x88
-        wholeByteColor = 0x55;
-        break;
-      }
-    } else if (color == 4) {
-      if (y % 2 != 0) { // off
-        wholeByteColor = 0xFF;
-      } else { // on every other pixel
-        wholeByteColor = 0x55;
-      }
-    } else if (color == 3) { // DARK GRAY
-      if (y % 2 != 0) {      // off
-        wholeByteColor = 0x00;
-      } else { // on every other pixel
-        wholeByteColor = 0xAA;
-      }
-    } else if (color == 2) { // GRAY
-      if (y % 2 == 0) {
-        wholeByteColor = 0xAA;
-      } else {
-        wholeByteColor = 0x55;
-      }
-    }
 
-    memset(ptr, wholeByteColor, remainingWholeBytes);
+    memset(ptr, pattern, remainingWholeBytes);
 
     if (lastByteBits > 0) {
       uint8_t lastByteBitMask = 0x00;
@@ -711,87 +3598,430 @@ void Adafruit_SharpMem::drawFastRawHLine(int16_t x, int16_t y, int16_t w,
       }
       ptr += remainingWholeBytes;
 
-      if (color == 7) {
-        uint8_t pattern = 0x00;
-        switch (y % 4) {
-        case 0:
-          pattern = 0x77;
-          break;
-        case 1:
-          pattern = 0xBB;
-          break;
-        case 2:
-          pattern = 0xDD;
-          break;
-        case 3:
-          pattern = 0xEE;
-          break;
-        }
-        *ptr &= ~(lastByteBitMask & ~pattern);
-        *ptr |= lastByteBitMask & pattern;
-      } else if (color == 6) {
-        uint8_t pattern = 0x00;
-        switch (y % 4) {
-        case 0:
-          pattern = 0xEE;
-          break;
-        case 1:
-          pattern = 0xDD;
-          break;
-        case 2:
-          pattern = 0xBB;
-          break;
-        case 3:
-          pattern = 0x77;
-          break;
-        }
-        *ptr &= ~(lastByteBitMask & ~pattern);
-        *ptr |= lastByteBitMask & pattern;
-      } else if (color == 5) {
-        uint8_t pattern = 0x00;
-        switch (y % 4) {
-        case 0: // 0x11
-          pattern = 0xEE;
-          break;
-        case 1: // 0x22
-          pattern = 0x55;
-          break;
-        case 2: // 0xBB
-          pattern = 0xBB;
-          break;
-        case 3: // 0x88
-          pattern = 0x55;
-          break;
-        }
-        *ptr &= ~(lastByteBitMask & ~pattern);
-        *ptr |= lastByteBitMask & pattern;
-      } else if (color == 4) { // LIGHT GRAY
-        if (y % 2 != 0) {      // off
-          *ptr |= lastByteBitMask;
-        } else { // on every other pixel
-          *ptr &= ~(lastByteBitMask & ~0x55);
-          *ptr |= lastByteBitMask & 0x55;
-        }
-      } else if (color == 3) { // DARK GRAY
-        if (y % 2 != 0) {      // off
-          *ptr &= ~lastByteBitMask;
-        } else { // on every other pixel
-          *ptr &= ~(lastByteBitMask & ~0xAA);
-          *ptr |= lastByteBitMask & 0xAA;
-        }
-      } else if (color == 2) {
-        if (y % 2 == 0) {
-          *ptr &= ~(lastByteBitMask & ~0xAA);
-          *ptr |= lastByteBitMask & 0xAA;
-        } else {
-          *ptr &= ~(lastByteBitMask & ~0x55); // black pixels
-          *ptr |= lastByteBitMask & 0x55;     // white pixels
+      *ptr = (*ptr & ~lastByteBitMask) | (pattern & lastByteBitMask);
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Maps a rectangle given in the current rotation to raw (rotation 0)
+   coordinates, clipping it against the screen first
+
+    @param[in,out]  x
+                    The left edge, replaced by the raw left edge
+    @param[in,out]  y
+                    The top edge, replaced by the raw top edge
+    @param[in,out]  w
+                    The width, replaced by the raw width
+    @param[in,out]  h
+                    The height, replaced by the raw height
+    @param[in]  r
+                The rotation to undo, _rawRotation for buffer coordinates
+
+    @return false if nothing of the rectangle is left on screen
+*/
+/**************************************************************************/
+bool Adafruit_SharpMem::rawRect(int16_t &x, int16_t &y, int16_t &w,
+                                int16_t &h, uint8_t r) {
+  // the far edges in 32 bits, so that they do not wrap
+  int32_t right = (int32_t)x + w, bottom = (int32_t)y + h;
+  if ((w <= 0) || (h <= 0) || (right <= 0) || (bottom <= 0) ||
+      (x >= _width) || (y >= _height)) {
+    return false;
+  }
+  x = (x > 0) ? x : 0; // Clip left/top
+  y = (y > 0) ? y : 0;
+  w = ((right < _width) ? right : _width) - x; // Clip right/bottom
+  h = ((bottom < _height) ? bottom : _height) - y;
+
+  int16_t t;
+  switch (r) {
+  case 1:
+    t = x;
+    x = WIDTH - y - h;
+    y = t;
+    _swap_int16_t(w, h);
+    break;
+  case 2:
+    x = WIDTH - x - w;
+    y = HEIGHT - y - h;
+    break;
+  case 3:
+    t = x;
+    x = y;
+    y = HEIGHT - t - w;
+    _swap_int16_t(w, h);
+    break;
+  }
+  return true;
+}
+
+// Mask of the bits of byte 'b' that fall inside pixel columns [lo, hi)
+static inline uint8_t spanMask(int16_t b, int16_t lo, int16_t hi) {
+  lo = (lo > b * 8) ? lo - b * 8 : 0;
+  hi = (hi < b * 8 + 8) ? hi - b * 8 : 8;
+  return (uint8_t)((0xFF << lo) & (0xFF >> (8 - hi)));
+}
+
+// Copies pixel columns [x, x + w) of one raw row into another
+static void copyRawSpan(uint8_t *dst, const uint8_t *src, int16_t x,
+                        int16_t w) {
+  int16_t first = x / 8, last = (x + w - 1) / 8;
+  for (int16_t b = first; b <= last; b++) {
+    if ((b == first) || (b == last)) {
+      uint8_t mask = spanMask(b, x, x + w);
+      dst[b] = (dst[b] & ~mask) | (src[b] & mask);
+    } else {
+      // whole bytes in the middle of the span
+      memcpy(dst + b, src + b, last - b);
+      b = last - 1;
+    }
+  }
+}
+
+// Shifts pixel columns [x, x + w) of one raw row by dx pixels, 0 < |dx| < w.
+// Pixel n lives in bit (n & 7) of byte (n / 8), so moving pixels towards
+// higher columns is a left shift that carries into the next byte.
+static void shiftRawRow(uint8_t *row, int16_t rowBytes, int16_t x, int16_t w,
+                        int16_t dx) {
+  if (dx > 0) {
+    int16_t k = dx / 8, s = dx & 7;
+    // walk backwards so every source byte is read before it is overwritten
+    for (int16_t b = (x + w - 1) / 8; b >= (x + dx) / 8; b--) {
+      uint8_t v = row[b - k] << s;
+      if (s && (b - k - 1 >= 0)) {
+        v |= row[b - k - 1] >> (8 - s);
+      }
+      uint8_t mask = spanMask(b, x + dx, x + w);
+      row[b] = (row[b] & ~mask) | (v & mask);
+    }
+  } else {
+    int16_t k = -dx / 8, s = -dx & 7;
+    for (int16_t b = x / 8; b <= (x + w + dx - 1) / 8; b++) {
+      uint8_t v = row[b + k] >> s;
+      if (s && (b + k + 1 < rowBytes)) {
+        v |= row[b + k + 1] << (8 - s);
+      }
+      uint8_t mask = spanMask(b, x, x + w + dx);
+      row[b] = (row[b] & ~mask) | (v & mask);
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Scrolls a region of the display buffer horizontally, without
+   outputting to the display. Rows are shifted as whole bytes with the
+   carry taken from the neighbouring byte, so the cost does not depend on
+   the shift distance.
+
+    @param[in]  x
+                The left edge of the region
+    @param[in]  y
+                The top edge of the region
+    @param[in]  w
+                The width of the region
+    @param[in]  h
+                The height of the region
+    @param[in]  dx
+                Pixels to scroll by, positive to the right, negative to the
+                left
+    @param color The color to fill the uncovered columns with
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::scrollHorizontal(int16_t x, int16_t y, int16_t w,
+                                         int16_t h, int16_t dx,
+                                         uint16_t color) {
+  if (dx == 0) {
+    return;
+  }
+  if (!rawRect(x, y, w, h, _rawRotation)) {
+    SHARPMEM_STAT(clipped, 1);
+    return;
+  }
+  // marked once here, the uncovered columns go straight to writeRawHLine()
+  bufferChanged(x, y, w, h);
+
+  int16_t rowBytes = _rowBytes;
+
+  // Rotations 1 and 3 turn a horizontal scroll into a vertical one in raw
+  // coordinates, 2 and 3 also flip its direction.
+  if (_rawRotation & 2) {
+    dx = -dx;
+  }
+
+  if (_rawRotation & 1) {
+    int16_t n = abs(dx) < h ? abs(dx) : h;
+    if (dx > 0) {
+      for (int16_t i = y + h - 1; i >= y + n; i--) {
+        copyRawSpan(&sharpmem_buffer[i * rowBytes],
+                    &sharpmem_buffer[(i - n) * rowBytes], x, w);
+      }
+      for (int16_t i = y; i < y + n; i++) {
+        writeRawHLine(x, i, w, color);
+      }
+    } else {
+      for (int16_t i = y; i < y + h - n; i++) {
+        copyRawSpan(&sharpmem_buffer[i * rowBytes],
+                    &sharpmem_buffer[(i + n) * rowBytes], x, w);
+      }
+      for (int16_t i = y + h - n; i < y + h; i++) {
+        writeRawHLine(x, i, w, color);
+      }
+    }
+  } else {
+    int16_t n = abs(dx) < w ? abs(dx) : w;
+    for (int16_t i = y; i < y + h; i++) {
+      if (n < w) {
+        shiftRawRow(&sharpmem_buffer[i * rowBytes], rowBytes, x, w, dx);
+      }
+      writeRawHLine(dx > 0 ? x : x + w - n, i, n, color);
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Transposes a 1 bit bitmap in the format of the display buffer
+   (rows of (w + 7) / 8 bytes, leftmost pixel in bit 0), so that pixel x, y
+   ends up at y, x. Works on 8x8 blocks with shifts and masks.
+
+    @param[in]  src
+                The source bitmap, w by h pixels
+    @param[in]  w
+                The width of the source bitmap
+    @param[in]  h
+                The height of the source bitmap
+    @param[out] dst
+                The destination, h by w pixels, must not overlap src
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::transposeBitmap(const uint8_t *src, uint16_t w,
+                                        uint16_t h, uint8_t *dst) {
+  transposeBitmap(src, (w + 7) / 8, w, h, dst, (h + 7) / 8, false, false);
+}
+
+/**************************************************************************/
+/*!
+    @brief Rotates a 1 bit bitmap in the format of the display buffer (rows
+   of (w + 7) / 8 bytes, leftmost pixel in bit 0) the same way setRotation()
+   maps drawing coordinates onto the panel. Rotations 1 and 3 work on 8x8
+   blocks with shifts and masks, rotation 2 on whole bytes.
+
+    @param[in]  src
+                The source bitmap, w by h pixels
+    @param[in]  w
+                The width of the source bitmap
+    @param[in]  h
+                The height of the source bitmap
+    @param[out] dst
+                The destination, h by w pixels for rotations 1 and 3, must
+                not overlap src
+    @param[in]  rotation
+                The rotation, 0 to 3
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::rotateBitmap(const uint8_t *src, uint16_t w,
+                                     uint16_t h, uint8_t *dst,
+                                     uint8_t rotation) {
+  rotation &= 3;
+  rotateBitmap(src, (w + 7) / 8, w, h, dst,
+               ((rotation & 1 ? h : w) + 7) / 8, rotation);
+}
+
+/**************************************************************************/
+/*!
+    @brief rotateBitmap() with explicit row strides
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::rotateBitmap(const uint8_t *src, int16_t srcStride,
+                                     uint16_t w, uint16_t h, uint8_t *dst,
+                                     int16_t dstStride, uint8_t rotation) {
+  uint16_t bytes = (w + 7) / 8;
+
+  switch (rotation & 3) {
+  case 0:
+    for (uint16_t y = 0; y < h; y++) {
+      memcpy(dst + y * dstStride, src + y * srcStride, bytes);
+    }
+    break;
+  case 1: // x, y -> h - 1 - y, x
+    transposeBitmap(src, srcStride, w, h, dst, dstStride, true, false);
+    break;
+  case 2: { // x, y -> w - 1 - x, h - 1 - y
+    // Reversing the bytes of a row puts pixel x at bytes * 8 - 1 - x, which
+    // is 'pad' columns right of where it belongs when w is not a multiple
+    // of 8.
+    uint8_t pad = bytes * 8 - w;
+    for (uint16_t y = 0; y < h; y++) {
+      const uint8_t *s = src + (h - 1 - y) * srcStride;
+      uint8_t *d = dst + y * dstStride;
+      for (uint16_t i = 0; i < bytes; i++) {
+        uint16_t v = pgm_read_byte(&reversed[s[bytes - 1 - i]]);
+        if (i + 1 < bytes) {
+          v |= pgm_read_byte(&reversed[s[bytes - 2 - i]]) << 8;
         }
-      } else if (color == 1) {
-        *ptr |= lastByteBitMask;
-      } else {
-        *ptr &= ~lastByteBitMask;
+        d[i] = v >> pad;
+      }
+    }
+    break;
+  }
+  case 3: // x, y -> y, w - 1 - x
+    transposeBitmap(src, srcStride, w, h, dst, dstStride, false, true);
+    break;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Transposes a bitmap with explicit row strides, optionally
+   mirroring the result
+
+    @param[in]  src
+                The source bitmap, w by h pixels
+    @param[in]  srcStride
+                Bytes per source row
+    @param[in]  w
+                The width of the source bitmap
+    @param[in]  h
+                The height of the source bitmap
+    @param[out] dst
+                The destination, h by w pixels
+    @param[in]  dstStride
+                Bytes per destination row
+    @param[in]  mirrorX
+                true to flip the result left to right
+    @param[in]  mirrorY
+                true to flip the result top to bottom
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::transposeBitmap(const uint8_t *src, int16_t srcStride,
+                                        uint16_t w, uint16_t h, uint8_t *dst,
+                                        int16_t dstStride, bool mirrorX,
+                                        bool mirrorY) {
+  uint8_t in[8], out[8];
+
+  // Destination byte k of every row holds source rows 8k to 8k + 7, or
+  // h - 1 - 8k down to h - 8 - 8k when mirrored. Rows past the edge read as
+  // 0 and only land in the padding bits of the destination.
+  for (uint16_t k = 0; k < (h + 7) / 8; k++) {
+    for (uint16_t b = 0; b < (w + 7) / 8; b++) {
+      for (uint8_t i = 0; i < 8; i++) {
+        int16_t y = mirrorX ? h - 1 - (k * 8 + i) : k * 8 + i;
+        in[i] = ((y >= 0) && (y < (int16_t)h)) ? src[y * srcStride + b] : 0;
+      }
+      transpose8x8(in, 1, out, 1);
+      for (uint8_t j = 0; (j < 8) && (b * 8 + j < w); j++) {
+        uint16_t x = b * 8 + j;
+        dst[(mirrorY ? w - 1 - x : x) * dstStride + k] = out[j];
       }
     }
   }
-}
\ No newline at end of file
+}
+
+#ifdef SHARPMEM_STATS
+/**************************************************************************/
+/*!
+    @brief Takes a snapshot of the statistics counters
+
+    @return A copy of the counters
+*/
+/**************************************************************************/
+sharpmem_stats_t Adafruit_SharpMem::getStats(void) { return _stats; }
+
+/**************************************************************************/
+/*!
+    @brief Sets all statistics counters back to 0
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::resetStats(void) {
+  memset(&_stats, 0, sizeof(_stats));
+}
+#endif
+
+#ifdef SHARPMEM_TRACE
+/**************************************************************************/
+/*!
+    @brief Starts recording everything sent to the display into a buffer.
+   Each chip select pulse becomes one record: its length as two bytes, low
+   byte first, followed by the bytes sent while CS was high. A record that
+   does not fit is dropped and recording stops.
+
+    @param[in]  buffer
+                Where to record, or NULL to stop recording
+    @param[in]  size
+                Size of the buffer in bytes
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::setTraceBuffer(uint8_t *buffer, uint32_t size) {
+  _trace = buffer;
+  _traceSize = buffer ? size : 0;
+  _traceLength = 0;
+  _traceOverflow = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief Gets how much of the trace buffer holds complete records
+
+    @return The number of bytes recorded
+*/
+/**************************************************************************/
+uint32_t Adafruit_SharpMem::traceLength(void) { return _traceLength; }
+
+/**************************************************************************/
+/*!
+    @brief Checks whether recording stopped because the buffer was full
+
+    @return true if a record was dropped
+*/
+/**************************************************************************/
+bool Adafruit_SharpMem::traceOverflowed(void) { return _traceOverflow; }
+
+/**************************************************************************/
+/*!
+    @brief Opens a trace record when CS goes high
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::traceBegin(void) {
+  _traceRecord = _traceLength + 2;
+}
+
+/**************************************************************************/
+/*!
+    @brief Appends sent bytes to the open trace record
+
+    @param[in]  data
+                The bytes, before they are handed to the SPI device
+    @param[in]  len
+                How many there are
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::trace(const uint8_t *data, uint16_t len) {
+  if (_traceOverflow || !_trace) {
+    return;
+  }
+  if (_traceRecord + len > _traceSize) {
+    _traceOverflow = true;
+    return;
+  }
+  memcpy(_trace + _traceRecord, data, len);
+  _traceRecord += len;
+}
+
+/**************************************************************************/
+/*!
+    @brief Closes the open trace record when CS goes low
+*/
+/**************************************************************************/
+void Adafruit_SharpMem::traceEnd(void) {
+  if (_traceOverflow || !_trace) {
+    return;
+  }
+  uint32_t len = _traceRecord - _traceLength - 2;
+  _trace[_traceLength] = len & 0xFF;
+  _trace[_traceLength + 1] = len >> 8;
+  _traceLength = _traceRecord;
+}
+#endif
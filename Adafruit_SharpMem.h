@@ -30,6 +30,56 @@ All text above, and the splash screen must be included in any redistribution
 #define SHARPMEM_BIT_VCOM (0x02)     // 0x40 in LSB format
 #define SHARPMEM_BIT_CLEAR (0x04)    // 0x20 in LSB format
 
+#define SHARPMEM_LAYER_AND (0)  // black in either layer is black
+#define SHARPMEM_LAYER_OR (1)   // white in either layer is white
+#define SHARPMEM_LAYER_XOR (2)  // black foreground inverts the background
+#define SHARPMEM_LAYER_MASK (3) // foreground where the mask is set
+
+#define SHARPMEM_FILL_EVEN_ODD (0) // inside where an odd number of edges cross
+#define SHARPMEM_FILL_NONZERO (1)  // inside where the edges don't cancel out
+
+#define SHARPMEM_DITHER_BAYER4 (0)          // ordered, 4x4 threshold map
+#define SHARPMEM_DITHER_BAYER8 (1)          // ordered, 8x8 threshold map
+#define SHARPMEM_DITHER_FLOYD_STEINBERG (2) // error diffusion to 4 neighbours
+#define SHARPMEM_DITHER_ATKINSON (3)        // error diffusion, 3/4 of the error
+
+#ifdef SHARPMEM_STATS
+/**
+ * @brief Counters kept when SHARPMEM_STATS is defined. Define it in the build
+ * flags rather than in a sketch, so the library and the sketch agree on the
+ * class layout. Without it the counting compiles away completely.
+ */
+typedef struct {
+  uint32_t refreshes;     ///< refresh(), refreshLines/Rect() and steps
+  uint32_t refreshMicros; ///< Time spent in those calls
+  uint32_t linesSent;     ///< Panel lines sent
+  uint32_t bytesSent;     ///< Bytes sent, commands and trailers included
+  uint32_t clears;        ///< Clear commands sent
+  uint32_t vcomCommands;  ///< Display mode commands sent by maintainVCOM()
+  uint32_t pixels;        ///< drawPixel(), sloped line and dither pixels
+  uint32_t hLines;        ///< Runs written along buffer rows, by any call
+  uint32_t hLinePixels;   ///< Pixels in those runs
+  uint32_t vLines;        ///< Runs written down buffer columns, by any call
+  uint32_t vLinePixels;   ///< Pixels in those runs
+  uint32_t clipped;       ///< Drawing calls rejected entirely by clipping
+} sharpmem_stats_t;
+#endif
+
+// Defining SHARPMEM_TRACE in the build flags adds setTraceBuffer(), which
+// records every chip select pulse sent to the display for host-side replay
+
+#ifndef SHARPMEM_SPRITES
+#define SHARPMEM_SPRITES (4) // number of overlay sprites
+#endif
+
+#ifndef SHARPMEM_FLOOD_STACK
+#define SHARPMEM_FLOOD_STACK (64) // spans floodFill() can keep pending
+#endif
+
+#ifndef SHARPMEM_FLOOD_SPANS
+#define SHARPMEM_FLOOD_SPANS (256) // filled spans a pattern floodFill() records
+#endif
+
 /**
  * @brief Class to control a Sharp memory display
  *
@@ -45,8 +95,40 @@ public:
   uint8_t getPixel(uint16_t x, uint16_t y);
   void clearDisplay();
   void refresh(void);
+  uint16_t refreshLines(uint16_t first, uint16_t last);
+  uint16_t refreshRect(int16_t x, int16_t y, int16_t w, int16_t h);
+  void setRefreshChunking(uint16_t maxLines, uint32_t maxHoldMicros = 0);
+  bool beginRefresh(void);
+  bool refreshStep(uint16_t maxLines, uint32_t maxMicros = 0);
+  bool refreshDone(void);
+  void maintainVCOM(void);
+  void setVCOMInterval(uint16_t ms);
+  bool pollVCOM(void);
+  void setExtComIn(bool enable, int8_t pin = -1, uint16_t hz = 60);
+  void setBackground(const uint8_t *background,
+                     uint8_t rule = SHARPMEM_LAYER_AND,
+                     const uint8_t *mask = NULL);
+  bool setSprite(uint8_t n, const uint8_t *bitmap, uint16_t w, uint16_t h,
+                 const uint8_t *mask = NULL);
+  void moveSprite(uint8_t n, int16_t x, int16_t y);
+  void showSprite(uint8_t n, bool visible);
+#ifdef SHARPMEM_STATS
+  sharpmem_stats_t getStats(void);
+  void resetStats(void);
+#endif
+#ifdef SHARPMEM_TRACE
+  void setTraceBuffer(uint8_t *buffer, uint32_t size);
+  uint32_t traceLength(void);
+  bool traceOverflowed(void);
+#endif
+  void setRotation(uint8_t r);
+  void setRotateOnRefresh(bool enable);
+  void setMirror(bool mirrorX, bool mirrorY);
+  bool setTransposedBuffer(bool enable);
+  bool setRowAlignment(uint8_t bytes);
   void clearDisplayBuffer();
-  void setBitmap(uint8_t *bitmap);
+  void fillScreen(uint16_t color);
+  void setBitmap(uint8_t *bitmap, bool rotated = false);
   void drawFatLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
                    int16_t strokeWidth, uint16_t color);
 
@@ -54,16 +136,173 @@ public:
   void fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color);
   void fillCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t cornername,
                         int16_t delta, uint16_t color);
+  void fillEllipse(int16_t x0, int16_t y0, int16_t rx, int16_t ry,
+                   uint16_t color);
+  bool fillPolygon(const int16_t *points, uint16_t n, uint16_t color,
+                   uint8_t rule = SHARPMEM_FILL_EVEN_ODD);
+  bool floodFill(int16_t x, int16_t y, uint16_t color);
+  void fillArc(int16_t x0, int16_t y0, int16_t r, int16_t ir, int16_t start,
+               int16_t end, uint16_t color);
+  void drawArc(int16_t x0, int16_t y0, int16_t r, int16_t start, int16_t end,
+               int16_t strokeWidth, uint16_t color);
+  void drawBezier(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2,
+                  int16_t y2, int16_t strokeWidth, uint16_t color);
+  void drawBezier(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2,
+                  int16_t y2, int16_t x3, int16_t y3, int16_t strokeWidth,
+                  uint16_t color);
+  bool drawGrayscaleDithered(int16_t x, int16_t y, const uint8_t img[],
+                             int16_t w, int16_t h, uint8_t method);
+  bool drawGrayscaleDithered(int16_t x, int16_t y, uint8_t *img, int16_t w,
+                             int16_t h, uint8_t method);
   void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+  void writeLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                 uint16_t color);
+  void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                uint16_t color);
+  void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color);
+  void drawCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t cornername,
+                        uint16_t color);
+  void drawRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r,
+                     uint16_t color);
+  void fillRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r,
+                     uint16_t color);
   void drawFastRawVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
   void drawFastRawHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
-  void copyPixelBuffer(uint8_t *bitmap);
+  void copyPixelBuffer(uint8_t *bitmap, bool rotated = false);
+  void scrollHorizontal(int16_t x, int16_t y, int16_t w, int16_t h,
+                        int16_t dx, uint16_t color);
+
+  static void transposeBitmap(const uint8_t *src, uint16_t w, uint16_t h,
+                              uint8_t *dst);
+  static void rotateBitmap(const uint8_t *src, uint16_t w, uint16_t h,
+                           uint8_t *dst, uint8_t rotation);
 
 private:
+  /// An image refresh() draws over the buffer while sending
+  struct Sprite {
+    const uint8_t *bitmap;  ///< The image, in the drawing orientation
+    const uint8_t *mask;    ///< Optional, clear bits are transparent
+    int16_t x, y;           ///< Position, in the current rotation
+    uint16_t w, h;          ///< Size of the image
+    int16_t rx, ry, rw, rh; ///< Clipped area it covers in the buffer
+    bool visible;           ///< Whether refresh() draws it
+  };
+  struct FloodSpan {
+    int16_t y;      ///< A row that has been filled from xl to xr
+    int16_t xl, xr; ///< The filled pixels
+    int8_t dy;      ///< Which neighbouring row to look at next
+  };
+  struct Edge {
+    int16_t top;    ///< The first row the edge crosses
+    int16_t bottom; ///< The first row below the edge
+    int32_t dy;     ///< Rows it spans, up to 65535
+    int32_t x;      ///< Where it crosses the current row, rounded down
+    int32_t frac;   ///< The rest of that, in 1/dy pixels
+    int32_t step;   ///< How far x moves per row, rounded down
+    int32_t rem;    ///< The rest of that, in 1/dy pixels
+    int8_t dir;     ///< 1 going down, -1 going up
+  };
+
+  static void transposeBitmap(const uint8_t *src, int16_t srcStride,
+                              uint16_t w, uint16_t h, uint8_t *dst,
+                              int16_t dstStride, bool mirrorX, bool mirrorY);
+  static void rotateBitmap(const uint8_t *src, int16_t srcStride, uint16_t w,
+                           uint16_t h, uint8_t *dst, int16_t dstStride,
+                           uint8_t rotation);
+  bool rawRect(int16_t &x, int16_t &y, int16_t &w, int16_t &h, uint8_t r);
+  void sendLines(uint16_t first, uint16_t last, const uint8_t *skip = NULL);
+  void sendClear(void);
+  void forgetWhiteLines(void);
+  void clearRows(int16_t y, int16_t h);
+  uint8_t compose(uint8_t fg, uint16_t offset);
+  uint8_t overlay(uint8_t v, int16_t row, int16_t col);
+  void placeSprite(uint8_t n);
+  void spriteChanged(uint8_t n);
+  void panelLines(int16_t x, int16_t &y, int16_t w, int16_t &h);
+  void beginLines(uint8_t cmd);
+  void sendLine(uint16_t currentline);
+  void endLines(void);
+  bool flip180(void);
+  void bufferChanged(int16_t x, int16_t y, int16_t w, int16_t h);
+  void bufferChanged(void);
+  uint16_t stride(uint16_t pixels);
+  uint32_t bufferBytes(void);
+  void fetchLine(uint16_t line, uint8_t *dst);
+  void transposeLines(uint16_t group, bool reverse);
+  void circleOutline(int16_t x0, int16_t y0, int16_t r, uint8_t corners,
+                     bool axes, uint16_t color);
+  void circleSpans(int16_t x0, int16_t y0, int16_t r, uint8_t corners,
+                   int16_t delta, uint16_t color);
+  void ellipseRow(int16_t x0, int16_t y0, int16_t x, int16_t y,
+                  uint16_t color);
+  void arcRow(int16_t x0, int16_t y0, int16_t y, int16_t inner, int16_t outer,
+              const int16_t *rays, int16_t sweep, uint16_t color);
+  void bezier(const int16_t *points, uint8_t degree, int16_t strokeWidth,
+              uint16_t color);
+  bool dither(int16_t x, int16_t y, const uint8_t *img, int16_t w, int16_t h,
+              uint8_t method, bool progmem);
+  void brushSpans(int32_t x, int32_t y, int16_t w, uint16_t color);
+  bool beginSpans(int32_t x, int32_t y, int32_t w, int32_t h);
+  void writeSpan(int32_t x, int32_t y, int32_t w, uint16_t color);
+  void writeColumn(int32_t x, int32_t y, int32_t h, uint16_t color);
+  void writeRawHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+  void writeRawVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+  void circleRun(int16_t x0, int16_t y0, int32_t y, int32_t from, int32_t to,
+                 uint8_t corners, uint16_t color);
+
   Adafruit_SPIDevice *spidev = NULL;
   uint8_t *sharpmem_buffer = NULL;
   uint8_t _cs;
   uint8_t _sharpmem_vcom;
+  uint32_t _lastVCOM = 0;
+  uint16_t _vcomInterval = 0;
+  bool _extComIn = false;
+  int8_t _extComInPin = -1;
+  uint8_t _rawRotation = 0;
+  bool _rotateOnRefresh = false;
+  bool _mirrorX = false;
+  bool _mirrorY = false;
+  bool _transposed = false;
+  uint16_t _rowBytes = 0;
+  uint8_t _rowAlign = 1;
+  int16_t _spanLeft = 0; // clip box of writeSpan(), right/bottom exclusive
+  int16_t _spanTop = 0;
+  int16_t _spanRight = 0;
+  int16_t _spanBottom = 0;
+  uint8_t *_lineCache = NULL;
+  int16_t _cachedGroup = -1;
+  uint16_t _chunkLines = 0;
+  uint32_t _maxHoldMicros = 0;
+  uint8_t *_pendingLines = NULL;
+  uint16_t _pendingCount = 0;
+  uint16_t _nextLine = 0;
+  uint8_t _stepCmd;
+  uint8_t *_whiteLines = NULL;
+  uint16_t _whiteCount = 0;
+  bool _panelWhite = false;
+  uint8_t *_clearRows = NULL;
+  uint16_t _clearCount = 0;
+  uint16_t _bufferRows = 0;
+  const uint8_t *_background = NULL;
+  const uint8_t *_backgroundMask = NULL;
+  uint8_t _backgroundRule = SHARPMEM_LAYER_AND;
+  Sprite *_sprites = NULL;
+  uint8_t _shownSprites = 0;
+#ifdef SHARPMEM_STATS
+  sharpmem_stats_t _stats = {};
+#endif
+#ifdef SHARPMEM_TRACE
+  void traceBegin(void);
+  void trace(const uint8_t *data, uint16_t len);
+  void traceEnd(void);
+  uint8_t *_trace = NULL;
+  uint32_t _traceSize = 0;
+  uint32_t _traceLength = 0;
+  uint32_t _traceRecord = 0;
+  bool _traceOverflow = false;
+#endif
 };
 
 #endif
@@ -0,0 +1,122 @@
+// Host timings of the fast paths against what they stand in for, "bench
+// [rounds]". The numbers compare one build or one path with another on the
+// same computer; they are not the speed of a microcontroller.
+#include "Adafruit_SharpMem.h"
+#include "host.h"
+#include <chrono>
+
+typedef std::chrono::steady_clock Clock;
+
+static double microsSince(Clock::time_point start, uint32_t rounds) {
+  std::chrono::duration<double, std::micro> d = Clock::now() - start;
+  return d.count() / rounds;
+}
+
+// Regular polygons of radius 110 on 400x240, filled by fillPolygon() and as
+// the triangle fan around their center that GFX sketches draw instead
+static void polygons(uint32_t rounds) {
+  static const uint16_t corners[] = {6, 12, 32};
+  Adafruit_SharpMem display(&SPI, 10, 400, 240);
+  display.begin();
+  display.clearDisplayBuffer();
+
+  for (uint8_t i = 0; i < sizeof(corners) / sizeof(corners[0]); i++) {
+    uint16_t n = corners[i];
+    int16_t points[2 * 32];
+    for (uint16_t k = 0; k < n; k++) {
+      double a = 2 * M_PI * k / n;
+      points[2 * k] = 200 + (int16_t)lround(110 * cos(a));
+      points[2 * k + 1] = 120 + (int16_t)lround(110 * sin(a));
+    }
+
+    Clock::time_point start = Clock::now();
+    for (uint32_t j = 0; j < rounds; j++) {
+      display.fillPolygon(points, n, j & 1);
+    }
+    double polygon = microsSince(start, rounds);
+
+    start = Clock::now();
+    for (uint32_t j = 0; j < rounds; j++) {
+      for (uint16_t k = 0; k < n; k++) {
+        uint16_t m = (k + 1) % n;
+        display.fillTriangle(200, 120, points[2 * k], points[2 * k + 1],
+                             points[2 * m], points[2 * m + 1], j & 1);
+      }
+    }
+    double fan = microsSince(start, rounds);
+
+    printf("bench: %2u corners, fillPolygon() %7.2f us, triangle fan "
+           "%7.2f us\n",
+           n, polygon, fan);
+  }
+}
+
+// Circle outlines on 400x240, some clipped by the edges, with drawCircle()
+// and with the Adafruit GFX version it replaces, a pixel at a time
+static void circles(uint32_t rounds) {
+  static const int16_t radii[] = {10, 60, 150};
+  Adafruit_SharpMem display(&SPI, 10, 400, 240);
+  display.begin();
+  display.clearDisplayBuffer();
+
+  for (uint8_t i = 0; i < sizeof(radii) / sizeof(radii[0]); i++) {
+    int16_t r = radii[i];
+    Clock::time_point start = Clock::now();
+    for (uint32_t j = 0; j < rounds; j++) {
+      display.drawCircle(200, 120, r, j & 1);
+    }
+    double runs = microsSince(start, rounds);
+
+    start = Clock::now();
+    for (uint32_t j = 0; j < rounds; j++) {
+      display.Adafruit_GFX::drawCircle(200, 120, r, j & 1);
+    }
+    double pixels = microsSince(start, rounds);
+
+    printf("bench: radius %3d, drawCircle() %7.2f us, pixel by pixel "
+           "%7.2f us\n",
+           r, runs, pixels);
+  }
+}
+
+// Full frames of a 400x240 and a 144x168 panel sent plain and with each
+// setMirror() setting, the best of five passes taken in turn. The host SPI
+// stub only logs the bytes, so the time is mostly fetching the lines.
+static void mirrors(uint32_t rounds) {
+  static const uint16_t panels[][2] = {{400, 240}, {144, 168}};
+  static const char *names[] = {"plain", "mirror x", "mirror y", "mirror xy"};
+
+  for (uint8_t i = 0; i < 2; i++) {
+    Adafruit_SharpMem display(&SPI, 10, panels[i][0], panels[i][1]);
+    display.begin();
+    display.clearDisplayBuffer();
+    display.fillRect(0, 0, panels[i][0], panels[i][1], 5); // no white lines
+    hostBus.reserve(16 * 1024);
+
+    double best[4] = {1e9, 1e9, 1e9, 1e9};
+    for (uint8_t pass = 0; pass < 5; pass++) {
+      for (uint8_t m = 0; m < 4; m++) {
+        display.setMirror(m & 1, m & 2);
+        Clock::time_point start = Clock::now();
+        for (uint32_t j = 0; j < rounds; j++) {
+          display.refresh();
+          hostBus.clear();
+        }
+        double t = microsSince(start, rounds);
+        best[m] = (t < best[m]) ? t : best[m];
+      }
+    }
+    for (uint8_t m = 0; m < 4; m++) {
+      printf("bench: %ux%u refresh(), %-9s %7.2f us\n", panels[i][0],
+             panels[i][1], names[m], best[m]);
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  uint32_t rounds = (argc > 1) ? strtoul(argv[1], NULL, 0) : 2000;
+  polygons(rounds);
+  circles(rounds);
+  mirrors(rounds);
+  return 0;
+}
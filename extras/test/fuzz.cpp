@@ -0,0 +1,596 @@
+// Differential fuzz test of the drawing fast paths. An input picks a panel
+// size and buffer layout, then a list of primitives, rotations and colors
+// that is drawn on the library and on ReferenceCanvas. The panel image sent
+// by refresh() and getPixel() must match the reference pixel for pixel.
+//
+// Built on its own it runs random inputs, "fuzz [runs] [seed]". Built with
+// -DHOST_LIBFUZZER and -fsanitize=fuzzer, libFuzzer drives it instead.
+#include "Adafruit_SharpMem.h"
+#include "host.h"
+#include "reference.h"
+
+static const uint16_t sizes[][2] = {{96, 96},   {144, 168}, {168, 144},
+                                    {400, 240}, {100, 60},  {13, 9}};
+
+struct Input {
+  const uint8_t *data;
+  size_t len;
+  size_t pos;
+  bool far; // one position and radius in four anywhere in int16_t
+
+  uint8_t byte(void) { return (pos < len) ? data[pos++] : 0; }
+  int16_t word(void) { return (int16_t)(byte() | (byte() << 8)); }
+  int16_t coord(int16_t limit) { // a little past either edge
+    if (far && !(byte() & 3)) {
+      return word();
+    }
+    uint16_t v = byte() | (byte() << 8);
+    return (int16_t)(v % (limit + 64)) - 32;
+  }
+  int16_t length(int16_t limit) { return 1 + byte() % limit; }
+  int16_t radius(void) {
+    if (far && !(byte() & 3)) {
+      return word() & 0x7FFF;
+    }
+    return byte() % 64;
+  }
+};
+
+static void fail(const char *what, const uint8_t *data, size_t len) {
+  printf("fuzz: %s, input:", what);
+  for (size_t i = 0; i < len; i++) {
+    printf(" %02x", data[i]);
+  }
+  printf("\n");
+  fflush(stdout);
+  abort();
+}
+
+// The runs of an area along the buffer rows, which floodFill() fills one
+// span each
+static uint32_t bufferRuns(ReferenceCanvas &ref,
+                           const std::vector<uint8_t> &area) {
+  int16_t uw = ref.width(), uh = ref.height(), size = (uw > uh) ? uw : uh;
+  std::vector<uint8_t> raw(size * size, 0);
+  uint32_t runs = 0;
+  for (int16_t y = 0; y < uh; y++) {
+    for (int16_t x = 0; x < uw; x++) {
+      int16_t bx = x, by = y;
+      ref.raw(bx, by);
+      raw[by * size + bx] = area[y * uw + x];
+    }
+  }
+  for (size_t i = 0; i < raw.size(); i++) {
+    runs += raw[i] && (!(i % size) || !raw[i - 1]);
+  }
+  return runs;
+}
+
+// floodFill() may only give up when the area has so many runs that its span
+// stack, or for a pattern its record of filled spans, could have run out.
+// The stack takes at most three spans for every run filled, and a fill that
+// gives up leaves nothing outside the area changed.
+static void floodFill(Adafruit_SharpMem &display, ReferenceCanvas &ref,
+                      int16_t x0, int16_t y0, uint16_t color,
+                      const uint8_t *data, size_t len) {
+  int16_t uw = display.width(), uh = display.height();
+  std::vector<uint8_t> before(uw * uh), area;
+  for (int16_t y = 0; y < uh; y++) {
+    for (int16_t x = 0; x < uw; x++) {
+      before[y * uw + x] = display.getPixel(x, y);
+    }
+  }
+  bool filled = display.floodFill(x0, y0, color);
+  ref.floodFill(x0, y0, color, &area);
+  if (filled) {
+    return;
+  }
+
+  uint32_t runs = bufferRuns(ref, area);
+  bool pattern = (color > 1) && (color < 8);
+  if ((3 * runs + 2 <= SHARPMEM_FLOOD_STACK) &&
+      (!pattern || (runs <= SHARPMEM_FLOOD_SPANS))) {
+    fail("floodFill() gave up on an area it has room for", data, len);
+  }
+  for (int16_t y = 0; y < uh; y++) {
+    for (int16_t x = 0; x < uw; x++) {
+      uint8_t v = display.getPixel(x, y);
+      if ((v != before[y * uw + x]) &&
+          (!area[y * uw + x] || (v != ref.user(x, y)))) {
+        fail("floodFill() that gave up drew outside the area", data, len);
+      }
+      ref.drawPixel(x, y, v); // carry on from what was drawn
+    }
+  }
+}
+
+// A gradient across the image with noise on it, so every gray level and
+// every dither method has something to do
+static void grayImage(int16_t w, int16_t h, uint32_t state,
+                      std::vector<uint8_t> &img) {
+  img.resize(w * h);
+  for (int32_t i = 0; i < w * h; i++) {
+    state ^= state << 13; // xorshift32
+    state ^= state >> 17;
+    state ^= state << 5;
+    int16_t v = (i % w) * 255 / w + (int16_t)(state % 97) - 48;
+    img[i] = (v < 0) ? 0 : (v > 255) ? 255 : v;
+  }
+}
+
+// An image in RAM goes to the uint8_t * overload, a const one is read as
+// PROGMEM, which is plain memory on the host
+static void dither(Adafruit_SharpMem &display, ReferenceCanvas &ref,
+                   int16_t x, int16_t y, std::vector<uint8_t> &img, int16_t w,
+                   int16_t h, uint8_t method, bool progmem) {
+  const uint8_t *image = &img[0];
+  if (progmem) {
+    display.drawGrayscaleDithered(x, y, image, w, h, method);
+  } else {
+    display.drawGrayscaleDithered(x, y, &img[0], w, h, method);
+  }
+  ref.dither(x, y, image, w, h, method);
+}
+
+// drawBezier() follows the curve one pixel at a time, which no simple model
+// repeats exactly. Pixels within half the stroke width of the curve, less a
+// margin, must be drawn and so must the ends; pixels further out than half
+// the width and the margin must not be. A curve that would take more than
+// twice SHARPMEM_MAX_CURVE_STEPS steps moves over two pixels a step and cuts
+// its corners along chords; for those only the box of the points, grown by
+// the stroke, is checked.
+static void bezier(Adafruit_SharpMem &display, ReferenceCanvas &ref,
+                   const int16_t *points, uint8_t degree, int16_t stroke,
+                   uint16_t color, const uint8_t *data, size_t len) {
+  // the walk stays within about a pixel of the curve, and an even brush is
+  // centered half a pixel down and right of it
+  double margin = (stroke & 1) ? 1.5 : 2.25;
+  int16_t uw = display.width(), uh = display.height();
+  const int16_t *last = points + 2 * degree;
+  if (degree == 2) {
+    display.drawBezier(points[0], points[1], points[2], points[3], points[4],
+                       points[5], stroke, color);
+  } else {
+    display.drawBezier(points[0], points[1], points[2], points[3], points[4],
+                       points[5], points[6], points[7], stroke, color);
+  }
+
+  int32_t box[4] = {INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN};
+  int32_t steps = 1;
+  for (uint8_t i = 0; i <= degree; i++) {
+    if (i) {
+      steps = std::max<int32_t>(steps, abs(points[2 * i] - points[2 * i - 2]));
+      steps = std::max<int32_t>(steps,
+                                abs(points[2 * i + 1] - points[2 * i - 1]));
+    }
+    box[0] = std::min<int32_t>(box[0], points[2 * i] - stroke);
+    box[1] = std::min<int32_t>(box[1], points[2 * i + 1] - stroke);
+    box[2] = std::max<int32_t>(box[2], points[2 * i] + stroke);
+    box[3] = std::max<int32_t>(box[3], points[2 * i + 1] + stroke);
+  }
+  bool capped = steps * degree > 2 * 1024; // SHARPMEM_MAX_CURVE_STEPS
+
+  std::vector<double> dist;
+  if (!capped) {
+    ref.curveDistance(points, degree, stroke / 2.0 + margin + 1, dist);
+  }
+  ReferenceCanvas painted(ref);
+  painted.fillScreen(color);
+  for (int16_t y = 0; y < uh; y++) {
+    for (int16_t x = 0; x < uw; x++) {
+      uint8_t v = display.getPixel(x, y);
+      uint8_t old = ref.user(x, y), on = painted.user(x, y);
+      if (capped) {
+        if ((v != old) && ((v != on) || (x < box[0]) || (y < box[1]) ||
+                           (x > box[2]) || (y > box[3]))) {
+          fail("drawBezier() is off the box of its points", data, len);
+        }
+        ref.drawPixel(x, y, v);
+        continue;
+      }
+      double d = dist[y * uw + x];
+      bool end = ((x == points[0]) && (y == points[1])) ||
+                 ((x == last[0]) && (y == last[1]));
+      bool must = end || (d <= stroke / 2.0 - margin);
+      bool may = d <= stroke / 2.0 + margin;
+      if ((must && (v != on)) || (!may && (v != old)) ||
+          ((v != old) && (v != on))) {
+        fail("drawBezier() is off the curve", data, len);
+      }
+      ref.drawPixel(x, y, v);
+    }
+  }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t len) {
+  Input in = {data, len, 0, false};
+  uint8_t config = in.byte();
+  uint8_t options = in.byte();
+  int16_t w = sizes[config % 6][0], h = sizes[config % 6][1];
+
+  Adafruit_SharpMem display(&SPI, 10, w, h);
+  ReferenceCanvas ref(w, h);
+  VirtualPanel panel(w, h);
+  display.begin();
+  uint8_t align = 1 << ((config >> 3) & 3);
+  display.setRowAlignment(align);
+  ref.transposed = (options & 1) && display.setTransposedBuffer(true);
+  ref.rotateOnRefresh = options & 2;
+  display.setRotateOnRefresh(ref.rotateOnRefresh);
+  ref.mirrorX = options & 4;
+  ref.mirrorY = options & 8;
+  display.setMirror(ref.mirrorX, ref.mirrorY);
+  display.clearDisplayBuffer(); // begin() leaves it uninitialized
+
+  // the primitives that take positions and radii anywhere in int16_t, for
+  // a quarter of the inputs
+  static const uint32_t farOps =
+      (1UL << 4) | (1UL << 6) | (1UL << 7) | (1UL << 10) | (1UL << 15) |
+      (1UL << 16) | (1UL << 17) | (1UL << 18);
+  bool far = (options & 0x30) == 0x30;
+
+  while (in.pos < in.len) {
+    uint8_t op = in.byte() % 21;
+    in.far = far && ((farOps >> op) & 1);
+    uint16_t color = in.byte() % 10;
+    int16_t uw = display.width(), uh = display.height();
+    int16_t x0 = in.coord(uw), y0 = in.coord(uh);
+    int16_t x1 = in.coord(uw), y1 = in.coord(uh);
+    int16_t x2 = in.coord(uw), y2 = in.coord(uh);
+    int16_t dx = in.length(uw + 32), dy = in.length(uh + 32);
+    int16_t r = in.radius();
+
+    // rectangles also get negative widths and heights, which go left and
+    // up; other sizes are kept positive, GFX draws odd things for those
+    if ((op == 3) || (op == 5) || (op == 8) || (op == 9)) {
+      uint8_t flip = in.byte();
+      dx = (flip & 1) ? -dx : dx;
+      dy = (flip & 2) ? -dy : dy;
+    }
+    switch (op) {
+    case 0:
+      display.drawPixel(x0, y0, color);
+      ref.drawPixel(x0, y0, color);
+      break;
+    case 1:
+      display.drawFastHLine(x0, y0, dx, color);
+      ref.drawFastHLine(x0, y0, dx, color);
+      break;
+    case 2:
+      display.drawFastVLine(x0, y0, dy, color);
+      ref.drawFastVLine(x0, y0, dy, color);
+      break;
+    case 3:
+      display.fillRect(x0, y0, dx, dy, color);
+      ref.fillRect(x0, y0, dx, dy, color);
+      break;
+    case 4:
+      display.drawLine(x0, y0, x1, y1, color);
+      ref.drawLine(x0, y0, x1, y1, color);
+      break;
+    case 5:
+      display.drawRect(x0, y0, dx, dy, color);
+      ref.drawRect(x0, y0, dx, dy, color);
+      break;
+    case 6:
+      display.drawCircle(x0, y0, r, color);
+      ref.drawCircle(x0, y0, r, color);
+      break;
+    case 7:
+      display.fillCircle(x0, y0, r, color);
+      ref.fillCircle(x0, y0, r, color);
+      break;
+    case 8:
+      display.drawRoundRect(x0, y0, dx, dy, r, color);
+      ref.drawRoundRect(x0, y0, dx, dy, r, color);
+      break;
+    case 9:
+      display.fillRoundRect(x0, y0, dx, dy, r, color);
+      ref.fillRoundRect(x0, y0, dx, dy, r, color);
+      break;
+    case 10:
+      display.drawTriangle(x0, y0, x1, y1, x2, y2, color);
+      ref.drawTriangle(x0, y0, x1, y1, x2, y2, color);
+      break;
+    case 11:
+      display.fillTriangle(x0, y0, x1, y1, x2, y2, color);
+      ref.fillTriangle(x0, y0, x1, y1, x2, y2, color);
+      break;
+    case 12:
+      display.fillScreen(color);
+      ref.fillScreen(color);
+      break;
+    case 13:
+      display.setRotation(color & 3);
+      ref.setRotation(color & 3);
+      if (ref.transposed || ref.rotateOnRefresh) {
+        // the buffer layout changed, which needs a redraw
+        display.fillScreen(1);
+        ref.fillScreen(1);
+      }
+      break;
+    case 14:
+      floodFill(display, ref, x0, y0, color, data, len);
+      break;
+    case 15: {
+      int16_t points[2 * 12];
+      uint16_t n = 3 + r % 10;
+      bool nonzero = r & 0x20;
+      for (uint16_t i = 0; i < n; i++) {
+        points[2 * i] = in.coord(uw);
+        points[2 * i + 1] = in.coord(uh);
+      }
+      display.fillPolygon(points, n, color,
+                          nonzero ? SHARPMEM_FILL_NONZERO
+                                  : SHARPMEM_FILL_EVEN_ODD);
+      ref.fillPolygon(points, n, color, nonzero);
+      break;
+    }
+    case 16: {
+      int16_t start = 2 * x1 - 360, end = 2 * y1 - 360, ir = dx % 80 - 8;
+      display.fillArc(x0, y0, r, ir, start, end, color);
+      ref.fillArc(x0, y0, r, ir, start, end, color);
+      break;
+    }
+    case 17: {
+      int16_t start = 2 * x1 - 360, end = 2 * y1 - 360, stroke = dx % 12;
+      display.drawArc(x0, y0, r, start, end, stroke, color);
+      if (stroke > 0) {
+        ref.fillArc(x0, y0, r, r - stroke, start, end, color);
+      }
+      break;
+    }
+    case 18: {
+      int16_t points[] = {x0, y0, x1, y1, x2, y2, in.coord(uw), in.coord(uh)};
+      uint8_t degree = (r & 1) ? 3 : 2;
+      int16_t stroke = 1 + dx % 8;
+      if (!(r & 6)) { // all in one place, one stamp of the brush
+        display.drawBezier(x0, y0, x0, y0, x0, y0, stroke, color);
+        ref.brush(x0, y0, stroke, color);
+        break;
+      }
+      bezier(display, ref, points, degree, stroke, color, data, len);
+      break;
+    }
+    case 19: {
+      int16_t iw = dx % 70 + 1, ih = dy % 50 + 1;
+      uint32_t seed = in.byte() | (in.byte() << 8) | 1;
+      std::vector<uint8_t> img;
+      grayImage(iw, ih, seed, img);
+      dither(display, ref, x0, y0, img, iw, ih, r & 3, r & 4);
+      break;
+    }
+    case 20: {
+      // a few pixels either way, or anything up to past the whole width
+      int16_t shift = (r & 1) ? x1 - x2 : r / 2 % 19 - 9;
+      display.scrollHorizontal(x0, y0, dx, dy, shift, color);
+      ref.scrollHorizontal(x0, y0, dx, dy, shift, color);
+      break;
+    }
+    }
+  }
+
+  for (int16_t y = 0; y < display.height(); y++) {
+    for (int16_t x = 0; x < display.width(); x++) {
+      if (display.getPixel(x, y) != ref.user(x, y)) {
+        fail("getPixel() differs", data, len);
+      }
+    }
+  }
+
+  // the raw layout: rows of the buffer, padded to the row alignment
+  bool portrait = ref.transposed && (display.getRotation() & 1);
+  int16_t rowBits = portrait ? h : w, rows = portrait ? w : h;
+  size_t rowBytes = ((rowBits + 7) / 8 + align - 1) / align * align;
+  std::vector<uint8_t> copy(rowBytes * rows);
+  display.copyPixelBuffer(&copy[0], false);
+  for (int16_t y = 0; y < display.height(); y++) {
+    for (int16_t x = 0; x < display.width(); x++) {
+      int16_t bx = x, by = y;
+      ref.raw(bx, by);
+      if (((copy[by * rowBytes + bx / 8] >> (bx & 7)) & 1) != ref.user(x, y)) {
+        fail("copyPixelBuffer() differs", data, len);
+      }
+    }
+  }
+  // rotated: width() by height(), rows never padded
+  rowBytes = (display.width() + 7) / 8;
+  copy.resize(rowBytes * display.height());
+  display.copyPixelBuffer(&copy[0], true);
+  for (int16_t y = 0; y < display.height(); y++) {
+    for (int16_t x = 0; x < display.width(); x++) {
+      if (((copy[y * rowBytes + x / 8] >> (x & 7)) & 1) != ref.user(x, y)) {
+        fail("rotated copyPixelBuffer() differs", data, len);
+      }
+    }
+  }
+
+  hostBus.clear();
+  display.refresh();
+  if (!panel.feed(hostBus)) {
+    fail(panel.error, data, len);
+  }
+  for (int16_t y = 0; y < h; y++) {
+    for (int16_t x = 0; x < w; x++) {
+      if (panel.get(x, y) != ref.panel(x, y)) {
+        fail("panel image differs", data, len);
+      }
+    }
+  }
+  return 0;
+}
+
+#ifndef HOST_LIBFUZZER
+// Pattern flood fills of a blank screen and of the inside of a rectangle on
+// the larger panels, which record a span for each of up to 240 rows
+static void floodRegressions(void) {
+  static const uint16_t panels[][2] = {{144, 168}, {400, 240}};
+  for (uint8_t i = 0; i < 2; i++) {
+    for (uint8_t outline = 0; outline < 2; outline++) {
+      for (uint8_t rotation = 0; rotation < 4; rotation++) {
+        for (uint16_t color = 2; color < 8; color++) {
+          int16_t w = panels[i][0], h = panels[i][1];
+          Adafruit_SharpMem display(&SPI, 10, w, h);
+          ReferenceCanvas ref(w, h);
+          display.begin();
+          display.clearDisplayBuffer();
+          display.setRotation(rotation);
+          ref.setRotation(rotation);
+          int16_t uw = display.width(), uh = display.height();
+          if (outline) {
+            display.drawRect(5, 7, uw - 12, uh - 16, 0);
+            ref.drawRect(5, 7, uw - 12, uh - 16, 0);
+          }
+          if (!display.floodFill(uw / 2, uh / 2, color)) {
+            printf("fuzz: floodFill() gave up on %dx%d, outline %d, "
+                   "rotation %d, color %d\n",
+                   w, h, outline, rotation, color);
+            fflush(stdout);
+            abort();
+          }
+          ref.floodFill(uw / 2, uh / 2, color);
+          for (int16_t y = 0; y < uh; y++) {
+            for (int16_t x = 0; x < uw; x++) {
+              if (display.getPixel(x, y) != ref.user(x, y)) {
+                printf("fuzz: floodFill() differs on %dx%d at %d,%d\n", w, h,
+                       x, y);
+                fflush(stdout);
+                abort();
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+  hostBus.clear();
+}
+
+// Every dither method from RAM and from PROGMEM, at odd positions and odd
+// widths, partly off every edge, in every rotation, on a panel whose width
+// is a multiple of 8 and on one whose width is not
+static void ditherRegressions(void) {
+  static const uint16_t panels[][2] = {{144, 168}, {100, 60}};
+  static const int16_t places[][4] = {
+      {3, 5, 37, 21}, {-5, 1, 13, 9}, {91, -3, 61, 17}, {1, 41, 1, 29}};
+  for (uint8_t i = 0; i < 2; i++) {
+    for (uint8_t rotation = 0; rotation < 4; rotation++) {
+      for (uint8_t method = 0; method < 4; method++) {
+        for (uint8_t progmem = 0; progmem < 2; progmem++) {
+          int16_t w = panels[i][0], h = panels[i][1];
+          Adafruit_SharpMem display(&SPI, 10, w, h);
+          ReferenceCanvas ref(w, h);
+          display.begin();
+          display.clearDisplayBuffer();
+          display.setRotation(rotation);
+          ref.setRotation(rotation);
+          for (uint8_t k = 0; k < 4; k++) {
+            const int16_t *p = places[k];
+            std::vector<uint8_t> img;
+            grayImage(p[2], p[3], 1 + k, img);
+            dither(display, ref, p[0], p[1], img, p[2], p[3], method, progmem);
+          }
+          for (int16_t y = 0; y < display.height(); y++) {
+            for (int16_t x = 0; x < display.width(); x++) {
+              if (display.getPixel(x, y) != ref.user(x, y)) {
+                printf("fuzz: drawGrayscaleDithered() differs on %dx%d, "
+                       "rotation %d, method %d, progmem %d at %d,%d\n",
+                       w, h, rotation, method, progmem, x, y);
+                fflush(stdout);
+                abort();
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// Shapes whose boxes reach past the range of int16_t, on 144x168 in every
+// rotation; each of them once ran off the buffer
+static void farRegressions(void) {
+  for (uint8_t rotation = 0; rotation < 4; rotation++) {
+    Adafruit_SharpMem display(&SPI, 10, 144, 168);
+    ReferenceCanvas ref(144, 168);
+    display.begin();
+    display.clearDisplayBuffer();
+    display.setRotation(rotation);
+    ref.setRotation(rotation);
+
+    display.fillEllipse(32700, 80, 640, 640, 0); // all of it off screen
+    display.fillEllipse(-32700, 80, 640, 640, 0);
+    display.fillCircle(70, 80, 20000, 3);
+    ref.fillCircle(70, 80, 20000, 3);
+    display.fillCircle(-32000, 90, 32100, 0);
+    ref.fillCircle(-32000, 90, 32100, 0);
+    display.drawCircle(70, 80, 20000, 0);
+    ref.drawCircle(70, 80, 20000, 0);
+    display.drawCircle(-32000, 90, 32070, 4);
+    ref.drawCircle(-32000, 90, 32070, 4);
+    display.drawLine(-20000, 10, 20000, 30, 0);
+    ref.drawLine(-20000, 10, 20000, 30, 0);
+    display.drawLine(-32768, -32768, 32767, 32767, 0);
+    ref.drawLine(-32768, -32768, 32767, 32767, 0);
+    display.drawLine(40, -32768, 100, 32767, 0);
+    ref.drawLine(40, -32768, 100, 32767, 0);
+    display.drawLine(-32768, 50, 32767, 50, 0);
+    ref.drawLine(-32768, 50, 32767, 50, 0);
+    display.drawLine(60, 32767, 60, -32768, 0);
+    ref.drawLine(60, 32767, 60, -32768, 0);
+    static const int16_t tall[] = {0, -20000, 100, 20000, 50, 0};
+    static const int16_t wide[] = {-32768, 20, 32767, 40,
+                                   30,     32767, 90, -32768};
+    display.fillPolygon(tall, 3, 2);
+    ref.fillPolygon(tall, 3, 2, false);
+    display.fillPolygon(wide, 4, 0, SHARPMEM_FILL_NONZERO);
+    ref.fillPolygon(wide, 4, 0, true);
+    display.fillArc(70, 80, 20000, 0, 0, 90, 0);
+    ref.fillArc(70, 80, 20000, 0, 0, 90, 0);
+    display.fillArc(-32000, 90, 32100, 32030, 30, 150, 3);
+    ref.fillArc(-32000, 90, 32100, 32030, 30, 150, 3);
+    display.drawArc(32000, 60, 31950, 200, 340, 50, 1);
+    ref.fillArc(32000, 60, 31950, 31900, 200, 340, 1);
+    display.fillArc(32767, 100, 32767, 0, 200, 340, 5);
+    ref.fillArc(32767, 100, 32767, 0, 200, 340, 5);
+    static const int16_t curve[] = {-32768, 20, 32767, 200, -32768, 32767,
+                                    100, 90};
+    bezier(display, ref, curve, 3, 5, 0, NULL, 0);
+    bezier(display, ref, curve + 2, 2, 3, 2, NULL, 0);
+
+    for (int16_t y = 0; y < display.height(); y++) {
+      for (int16_t x = 0; x < display.width(); x++) {
+        if (display.getPixel(x, y) != ref.user(x, y)) {
+          printf("fuzz: far shapes differ in rotation %d at %d,%d\n",
+                 rotation, x, y);
+          fflush(stdout);
+          abort();
+        }
+      }
+    }
+  }
+  hostBus.clear();
+}
+
+int main(int argc, char **argv) {
+  uint32_t runs = (argc > 1) ? strtoul(argv[1], NULL, 0) : 3000;
+  uint32_t state = (argc > 2) ? strtoul(argv[2], NULL, 0) : 1;
+  uint8_t data[512];
+
+  floodRegressions();
+  ditherRegressions();
+  farRegressions();
+
+  for (uint32_t run = 0; run < runs; run++) {
+    for (size_t i = 0; i < sizeof(data); i++) {
+      state ^= state << 13; // xorshift32
+      state ^= state >> 17;
+      state ^= state << 5;
+      data[i] = state;
+    }
+    LLVMFuzzerTestOneInput(data, 2 + (state >> 8) % (sizeof(data) - 2));
+  }
+  printf("fuzz: %u inputs match the reference\n", runs);
+  return 0;
+}
+#endif
@@ -0,0 +1,198 @@
+// Golden-frame tests of the refresh paths. Each scenario draws and refreshes
+// with SHARPMEM_TRACE on; the recorded trace must match traces/<name>.trace
+// byte for byte, replaying it must give the image the live bus gave, and
+// that image must match ReferenceCanvas.
+//
+//   golden            check every scenario
+//   golden --update   rewrite the golden traces after an intended change
+//
+// A trace that differs can be looked at with the replay tool.
+#include "Adafruit_SharpMem.h"
+#include "host.h"
+#include "reference.h"
+
+#ifndef SHARPMEM_TRACE
+#error "build with -DSHARPMEM_TRACE"
+#endif
+
+// Draws on the library and the reference alike
+#define BOTH(call)                                                             \
+  do {                                                                         \
+    display.call;                                                              \
+    ref.call;                                                                  \
+  } while (0)
+
+// A full frame, then a rectangle and a band of lines
+static void partial(Adafruit_SharpMem &display, ReferenceCanvas &ref) {
+  BOTH(fillScreen(1));
+  BOTH(fillRect(10, 10, 60, 40, 0));
+  BOTH(fillCircle(100, 120, 30, 4));
+  display.refresh();
+  BOTH(drawLine(20, 100, 60, 140, 0));
+  display.refreshRect(20, 100, 41, 41);
+  BOTH(fillRect(0, 150, 144, 8, 6));
+  display.refreshLines(150, 157);
+}
+
+// Mirrored both ways in turn, drawn in rotation 1
+static void mirrored(Adafruit_SharpMem &display, ReferenceCanvas &ref) {
+  BOTH(setRotation(1));
+  BOTH(fillScreen(1));
+  BOTH(fillTriangle(5, 5, 130, 20, 40, 160, 5));
+  BOTH(drawCircle(90, 100, 40, 0));
+  display.setMirror(true, false);
+  ref.mirrorX = true;
+  display.refresh();
+  display.setMirror(false, true);
+  ref.mirrorX = false;
+  ref.mirrorY = true;
+  display.refresh();
+}
+
+// A frame and a band of lines, both sent 32 lines per write command
+static void chunked(Adafruit_SharpMem &display, ReferenceCanvas &ref) {
+  display.setRefreshChunking(32);
+  BOTH(fillScreen(1));
+  BOTH(fillRoundRect(20, 20, 300, 180, 24, 2));
+  BOTH(fillCircle(300, 160, 60, 7));
+  BOTH(drawLine(0, 239, 399, 0, 0));
+  display.refresh();
+  BOTH(fillRect(40, 100, 320, 81, 3));
+  display.refreshLines(100, 180);
+}
+
+// A frame sent in chunks of at most 300 us, with every clock read taking 10
+static void held(Adafruit_SharpMem &display, ReferenceCanvas &ref) {
+  display.setRefreshChunking(0, 300);
+  BOTH(fillScreen(1));
+  BOTH(fillCircle(72, 84, 50, 0));
+  hostMicrosStep = 10;
+  display.refresh();
+  hostMicrosStep = 0;
+}
+
+// A sprite hidden halfway through a stepped refresh that already sent it
+static void sprite(Adafruit_SharpMem &display, ReferenceCanvas &ref) {
+  static const uint8_t black[8] = {0};
+  BOTH(fillScreen(1));
+  BOTH(fillRect(60, 60, 40, 40, 5));
+  display.setSprite(0, black, 8, 8);
+  display.moveSprite(0, 10, 10);
+  display.showSprite(0, true);
+  display.beginRefresh();
+  display.refreshStep(40);
+  display.showSprite(0, false);
+  while (!display.refreshStep(40)) {
+  }
+}
+
+// A background set halfway through a stepped refresh, over a white frame
+static void background(Adafruit_SharpMem &display, ReferenceCanvas &ref) {
+  static uint8_t layer[(144 / 8) * 168];
+  Adafruit_SharpMem canvas(&SPI, 11, 144, 168);
+  canvas.begin();
+  canvas.fillScreen(1);
+  canvas.fillCircle(72, 84, 60, 0);
+  canvas.copyPixelBuffer(layer);
+  hostBus.clear(); // the canvas is never refreshed
+
+  BOTH(fillScreen(1));
+  display.refresh();
+  BOTH(fillRect(10, 100, 124, 30, 3));
+  display.beginRefresh();
+  display.refreshStep(100);
+  display.setBackground(layer, SHARPMEM_LAYER_AND);
+  ref.fillCircle(72, 84, 60, 0); // black in either layer is black
+  while (!display.refreshStep(40)) {
+  }
+}
+
+static const struct {
+  const char *name;
+  int16_t w, h;
+  void (*run)(Adafruit_SharpMem &display, ReferenceCanvas &ref);
+} scenarios[] = {{"partial", 144, 168, partial},
+                 {"mirrored", 168, 144, mirrored},
+                 {"chunked", 400, 240, chunked},
+                 {"held", 144, 168, held},
+                 {"sprite", 144, 168, sprite},
+                 {"background", 144, 168, background}};
+
+static bool readFile(const char *path, std::vector<uint8_t> &data) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    return false;
+  }
+  int c;
+  while ((c = fgetc(f)) != EOF) {
+    data.push_back(c);
+  }
+  fclose(f);
+  return true;
+}
+
+static bool writeFile(const char *path, const std::vector<uint8_t> &data) {
+  FILE *f = fopen(path, "wb");
+  if (!f) {
+    return false;
+  }
+  fwrite(&data[0], 1, data.size(), f);
+  return fclose(f) == 0;
+}
+
+int main(int argc, char **argv) {
+  bool update = (argc > 1) && !strcmp(argv[1], "--update");
+  int failures = 0;
+
+  for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+    const char *name = scenarios[i].name;
+    int16_t w = scenarios[i].w, h = scenarios[i].h;
+    Adafruit_SharpMem display(&SPI, 10, w, h);
+    ReferenceCanvas ref(w, h);
+    VirtualPanel live(w, h), replayed(w, h);
+    std::vector<uint8_t> trace(65536);
+    const char *error = NULL;
+
+    display.begin();
+    display.clearDisplayBuffer(); // begin() leaves it uninitialized
+    display.setTraceBuffer(&trace[0], trace.size());
+    hostBus.clear();
+    scenarios[i].run(display, ref);
+    trace.resize(display.traceLength());
+
+    if (!live.feed(hostBus)) {
+      error = live.error;
+    } else if (display.traceOverflowed()) {
+      error = "trace buffer too small";
+    } else if (!replayed.replay(&trace[0], trace.size())) {
+      error = replayed.error;
+    } else if ((replayed.pixels != live.pixels) ||
+               (replayed.bytes != live.bytes)) {
+      error = "replay differs from the bus";
+    }
+    for (int16_t y = 0; !error && (y < h); y++) {
+      for (int16_t x = 0; x < w; x++) {
+        if (live.get(x, y) != ref.panel(x, y)) {
+          error = "panel image differs from the reference";
+          break;
+        }
+      }
+    }
+
+    char path[256];
+    snprintf(path, sizeof(path), "traces/%s.trace", name);
+    std::vector<uint8_t> golden;
+    if (!error && update) {
+      error = writeFile(path, trace) ? NULL : "cannot write the golden trace";
+    } else if (!error && !readFile(path, golden)) {
+      error = "no golden trace, run golden --update";
+    } else if (!error && (golden != trace)) {
+      error = "trace differs from the golden trace";
+    }
+
+    printf("golden: %s, %zu bytes, %s\n", name, trace.size(),
+           error ? error : (update ? "updated" : "ok"));
+    failures += error ? 1 : 0;
+  }
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,131 @@
+#include "host.h"
+#include <Adafruit_SPIDevice.h>
+#include <algorithm>
+
+uint32_t hostMicros = 0;
+uint32_t hostMicrosStep = 0;
+uint32_t hostMillis = 0;
+std::vector<int> hostBus;
+SPIClass SPI;
+
+uint32_t micros(void) { return hostMicros += hostMicrosStep; }
+uint32_t millis(void) { return hostMillis; }
+void pinMode(uint8_t pin, uint8_t mode) {}
+void yield(void) {}
+void tone(uint8_t pin, unsigned int hz, unsigned long ms) {}
+void noTone(uint8_t pin) {}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  hostBus.push_back(value ? HOST_CS_HIGH : HOST_CS_LOW);
+}
+
+void hostSend(const uint8_t *buffer, size_t len) {
+  hostBus.insert(hostBus.end(), buffer, buffer + len);
+}
+
+void hostTransaction(bool begin) {}
+
+VirtualPanel::VirtualPanel(int16_t w, int16_t h)
+    : width(w), height(h), pixels(w * h, 1) {}
+
+// The chip select of a memory LCD is active high
+bool VirtualPanel::feed(std::vector<int> &bus) {
+  for (size_t i = 0; i < bus.size(); i++) {
+    int v = bus[i];
+    if (v == HOST_CS_HIGH) {
+      selected = true;
+      pulse.clear();
+    } else if (v == HOST_CS_LOW) {
+      if (selected && !pulse.empty() && !command(&pulse[0], pulse.size())) {
+        break;
+      }
+      selected = false;
+    } else if (!selected) {
+      error = error ? error : "byte sent without chip select";
+    } else {
+      pulse.push_back(v);
+    }
+  }
+  bus.clear();
+  return !error;
+}
+
+bool VirtualPanel::command(const uint8_t *b, size_t len) {
+  commands++;
+  bytes += len;
+  if (b[0] & 0x04) { // clear, then a dummy byte
+    clears++;
+    std::fill(pixels.begin(), pixels.end(), 1);
+    if (len != 2) {
+      error = error ? error : "clear is not 2 bytes";
+    }
+    return !error;
+  }
+  if (!(b[0] & 0x01)) { // display mode, VCOM only
+    if (len != 2) {
+      error = error ? error : "display mode is not 2 bytes";
+    }
+    return !error;
+  }
+
+  // write: address, the line, a dummy byte, ... and a trailing dummy byte
+  size_t lineBytes = (width + 7) / 8, i = 1;
+  while (i + lineBytes + 2 <= len) {
+    int16_t line = b[i];
+    if ((line < 1) || (line > height) || b[i + 1 + lineBytes]) {
+      error = error ? error : "bad line address or dummy byte";
+      return false;
+    }
+    for (int16_t x = 0; x < width; x++) {
+      pixels[(line - 1) * width + x] = (b[i + 1 + x / 8] >> (x & 7)) & 1;
+    }
+    lines++;
+    i += lineBytes + 2;
+  }
+  if ((i + 1 != len) || b[i]) {
+    error = error ? error : "bad write command length or trailer";
+  }
+  return !error;
+}
+
+// A SHARPMEM_TRACE record is a 16-bit little-endian length and the bytes of
+// one chip select pulse. Returns the bytes used, 0 on an error.
+size_t VirtualPanel::replayRecord(const uint8_t *trace, size_t len) {
+  size_t n = (len < 2) ? 0 : trace[0] | (trace[1] << 8);
+  if (!n || (n + 2 > len)) {
+    error = error ? error : "truncated trace record";
+    return 0;
+  }
+  return command(trace + 2, n) ? n + 2 : 0;
+}
+
+bool VirtualPanel::replay(const uint8_t *trace, size_t len) {
+  size_t i = 0;
+  while (i < len) {
+    size_t n = replayRecord(trace + i, len - i);
+    if (!n) {
+      return false;
+    }
+    i += n;
+  }
+  return true;
+}
+
+bool VirtualPanel::writePBM(const char *path) const {
+  FILE *f = fopen(path, "wb");
+  if (!f) {
+    return false;
+  }
+  // PBM is 1 for black, most significant bit first
+  fprintf(f, "P4\n%d %d\n", width, height);
+  for (int16_t y = 0; y < height; y++) {
+    for (int16_t x = 0; x < width; x += 8) {
+      uint8_t byte = 0;
+      for (int16_t k = 0; (k < 8) && (x + k < width); k++) {
+        byte |= (get(x + k, y) ? 0 : 0x80) >> k;
+      }
+      fputc(byte, f);
+    }
+  }
+  return fclose(f) == 0;
+}
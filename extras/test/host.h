@@ -0,0 +1,41 @@
+// Host side of the tests: the clock, the SPI bus log and a virtual panel
+// that decodes what the library sends
+#ifndef HOST_H
+#define HOST_H
+
+#include <Arduino.h>
+#include <vector>
+
+#define HOST_CS_HIGH (-1) // chip select edges in hostBus
+#define HOST_CS_LOW (-2)
+
+extern uint32_t hostMicros;
+extern uint32_t hostMicrosStep; // how far the clock moves at every read
+extern uint32_t hostMillis;
+extern std::vector<int> hostBus; // bytes sent and HOST_CS_* edges
+
+// A memory LCD as the protocol describes it. Pixels are 1 for white.
+class VirtualPanel {
+public:
+  VirtualPanel(int16_t w, int16_t h);
+  bool feed(std::vector<int> &bus);
+  bool command(const uint8_t *bytes, size_t len);
+  size_t replayRecord(const uint8_t *trace, size_t len);
+  bool replay(const uint8_t *trace, size_t len);
+  uint8_t get(int16_t x, int16_t y) const { return pixels[y * width + x]; }
+  bool writePBM(const char *path) const;
+
+  int16_t width, height;
+  std::vector<uint8_t> pixels;
+  uint32_t commands = 0; // chip select pulses
+  uint32_t bytes = 0;
+  uint32_t lines = 0;
+  uint32_t clears = 0;
+  const char *error = NULL; // the first protocol error
+
+private:
+  std::vector<uint8_t> pulse;
+  bool selected = false;
+};
+
+#endif
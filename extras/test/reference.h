@@ -0,0 +1,482 @@
+// The slow reference the fast paths are checked against: every primitive is
+// the Adafruit GFX default, which ends in one drawPixel() per pixel, and
+// drawPixel() works out the panel pixel and the pattern on its own.
+#ifndef REFERENCE_H
+#define REFERENCE_H
+
+#include <Adafruit_GFX.h>
+#include <utility>
+#include <vector>
+
+class ReferenceCanvas : public Adafruit_GFX {
+public:
+  ReferenceCanvas(int16_t w, int16_t h)
+      : Adafruit_GFX(w, h), pixels(w * h, 1) {}
+
+  // The layout options of Adafruit_SharpMem that decide where the pattern
+  // colors are anchored: patterns follow the rows of the buffer
+  bool transposed = false;
+  bool rotateOnRefresh = false;
+  bool mirrorX = false;
+  bool mirrorY = false;
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) {
+    if ((x < 0) || (y < 0) || (x >= _width) || (y >= _height)) {
+      return;
+    }
+    int16_t bx = x, by = y;
+    raw(bx, by);
+    int16_t px = x, py = y;
+    rotate(rotation, px, py);
+    pixels[py * WIDTH + px] = colorAt(color, bx, by);
+  }
+
+  // GFX draws these through writeLine(), which paints two pixels for a zero
+  // length; like GFXcanvas1, the library draws nothing and flips negative
+  // lengths, so the reference does the same one pixel at a time
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    if (h < 0) {
+      h = -h;
+      y -= h - 1;
+    }
+    for (int16_t i = 0; i < h; i++) {
+      drawPixel(x, y + i, color);
+    }
+  }
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    if (w < 0) {
+      w = -w;
+      x -= w - 1;
+    }
+    for (int16_t i = 0; i < w; i++) {
+      drawPixel(x + i, y, color);
+    }
+  }
+  void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    drawFastVLine(x, y, h, color);
+  }
+  void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    drawFastHLine(x, y, w, color);
+  }
+
+  // Rectangles with a negative width or height go left or up from x, y, as
+  // the library's fillRect() always did; GFX draws odd shapes for those.
+  // Past that they are GFX's.
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    flip(x, w);
+    flip(y, h);
+    Adafruit_GFX::fillRect(x, y, w, h, color);
+  }
+  void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    flip(x, w);
+    flip(y, h);
+    Adafruit_GFX::drawRect(x, y, w, h, color);
+  }
+  void drawRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r,
+                     uint16_t color) {
+    flip(x, w);
+    flip(y, h);
+    Adafruit_GFX::drawRoundRect(x, y, w, h, r, color);
+  }
+  void fillRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r,
+                     uint16_t color) {
+    flip(x, w);
+    flip(y, h);
+    Adafruit_GFX::fillRoundRect(x, y, w, h, r, color);
+  }
+
+  // A pixel and a column with 32-bit positions, for the shapes below that
+  // reach past the range of int16_t
+  void pixel(int32_t x, int32_t y, uint16_t color) {
+    if ((x >= 0) && (y >= 0) && (x < _width) && (y < _height)) {
+      drawPixel(x, y, color);
+    }
+  }
+  void column(int32_t x, int32_t y, int32_t h, uint16_t color) {
+    if ((x < 0) || (x >= _width)) {
+      return;
+    }
+    for (int32_t i = (y > 0) ? y : 0; (i < y + h) && (i < _height); i++) {
+      drawPixel(x, i, color);
+    }
+  }
+
+  // GFX's writeLine() in 32 bits, the same pixels wherever GFX does not
+  // wrap. drawLine() takes it for lines along the axes too, which GFX draws
+  // the same way.
+  void writeLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                 uint16_t color) {
+    int32_t ax = x0, ay = y0, bx = x1, by = y1;
+    bool steep = labs(by - ay) > labs(bx - ax);
+    if (steep) {
+      std::swap(ax, ay);
+      std::swap(bx, by);
+    }
+    if (ax > bx) {
+      std::swap(ax, bx);
+      std::swap(ay, by);
+    }
+    int32_t dx = bx - ax, dy = labs(by - ay), err = dx / 2;
+    int32_t ystep = (ay < by) ? 1 : -1;
+    for (; ax <= bx; ax++) {
+      if (steep) {
+        pixel(ay, ax, color);
+      } else {
+        pixel(ax, ay, color);
+      }
+      err -= dy;
+      if (err < 0) {
+        ay += ystep;
+        err += dx;
+      }
+    }
+  }
+  void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                uint16_t color) {
+    writeLine(x0, y0, x1, y1, color);
+  }
+
+  // GFX's drawCircle() in 32 bits, as fillCircle() below
+  void drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+    int32_t f = 1 - r, ddF_x = 1, ddF_y = -2 * (int32_t)r;
+    int32_t x = 0, y = r;
+    pixel(x0, y0 + y, color);
+    pixel(x0, y0 - y, color);
+    pixel(x0 + y, y0, color);
+    pixel(x0 - y, y0, color);
+    while (x < y) {
+      if (f >= 0) {
+        y--;
+        ddF_y += 2;
+        f += ddF_y;
+      }
+      x++;
+      ddF_x += 2;
+      f += ddF_x;
+      pixel(x0 + x, y0 + y, color);
+      pixel(x0 - x, y0 + y, color);
+      pixel(x0 + x, y0 - y, color);
+      pixel(x0 - x, y0 - y, color);
+      pixel(x0 + y, y0 + x, color);
+      pixel(x0 - y, y0 + x, color);
+      pixel(x0 + y, y0 - x, color);
+      pixel(x0 - y, y0 - x, color);
+    }
+  }
+
+  // GFX's fillCircle() in 32 bits: the same pixels where GFX does not wrap,
+  // and the whole circle for a radius up to the end of int16_t
+  void fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+    int32_t f = 1 - r, ddF_x = 1, ddF_y = -2 * (int32_t)r;
+    int32_t x = 0, y = r, px = x, py = y;
+    column(x0, (int32_t)y0 - r, 2 * (int32_t)r + 1, color);
+    while (x < y) {
+      if (f >= 0) {
+        y--;
+        ddF_y += 2;
+        f += ddF_y;
+      }
+      x++;
+      ddF_x += 2;
+      f += ddF_x;
+      if (x < (y + 1)) {
+        column(x0 + x, y0 - y, 2 * y + 1, color);
+        column(x0 - x, y0 - y, 2 * y + 1, color);
+      }
+      if (y != py) {
+        column(x0 + py, y0 - px, 2 * px + 1, color);
+        column(x0 - py, y0 - px, 2 * px + 1, color);
+        py = y;
+      }
+      px = x;
+    }
+  }
+
+  // 4-connected, one pixel at a time. The pixels of the area are set in
+  // done, width() by height(), if it is given.
+  void floodFill(int16_t x, int16_t y, uint16_t color,
+                 std::vector<uint8_t> *area = NULL) {
+    std::vector<uint8_t> local;
+    std::vector<uint8_t> &done = area ? *area : local;
+    done.assign(_width * _height, 0);
+    if ((x < 0) || (y < 0) || (x >= _width) || (y >= _height)) {
+      return;
+    }
+    uint8_t old = user(x, y);
+    std::vector<std::pair<int16_t, int16_t> > todo(1, std::make_pair(x, y));
+    while (!todo.empty()) {
+      x = todo.back().first;
+      y = todo.back().second;
+      todo.pop_back();
+      if ((x < 0) || (y < 0) || (x >= _width) || (y >= _height) ||
+          done[y * _width + x] || (user(x, y) != old)) {
+        continue;
+      }
+      done[y * _width + x] = 1;
+      drawPixel(x, y, color);
+      todo.push_back(std::make_pair(x - 1, y));
+      todo.push_back(std::make_pair(x + 1, y));
+      todo.push_back(std::make_pair(x, y - 1));
+      todo.push_back(std::make_pair(x, y + 1));
+    }
+  }
+
+  // The region is clipped to the screen first; pixels move dx to the right
+  // within it and the columns they leave are filled with color
+  void scrollHorizontal(int16_t x, int16_t y, int16_t w, int16_t h,
+                        int16_t dx, uint16_t color) {
+    int16_t left = (x > 0) ? x : 0, right = (x + w < _width) ? x + w : _width;
+    int16_t top = (y > 0) ? y : 0, bottom = (y + h < _height) ? y + h : _height;
+    if (!dx || (left >= right) || (top >= bottom)) {
+      return;
+    }
+    std::vector<uint8_t> row(_width);
+    for (int16_t j = top; j < bottom; j++) {
+      for (int16_t i = left; i < right; i++) {
+        row[i] = user(i, j);
+      }
+      for (int16_t i = left; i < right; i++) {
+        int16_t from = i - dx;
+        bool kept = (from >= left) && (from < right);
+        drawPixel(i, j, kept ? row[from] : color);
+      }
+    }
+  }
+
+  // Pixel centers sit on whole coordinates; an edge crossing a row at xc
+  // counts for the pixels from xc on, so the right outline is left out
+  void fillPolygon(const int16_t *points, uint16_t n, uint16_t color,
+                   bool nonzero) {
+    for (int16_t y = 0; y < _height; y++) {
+      for (int16_t x = 0; x < _width; x++) {
+        int16_t winding = 0, crossings = 0;
+        for (uint16_t i = 0; i < n; i++) {
+          const int16_t *a = &points[2 * i];
+          const int16_t *b = &points[2 * ((i + 1) % n)];
+          int8_t dir = (a[1] < b[1]) ? 1 : -1;
+          if (dir < 0) {
+            std::swap(a, b);
+          }
+          if ((y < a[1]) || (y >= b[1])) {
+            continue; // horizontal edges cross no rows
+          }
+          int64_t dy = b[1] - a[1];
+          if ((int64_t)a[0] * dy + (int64_t)(y - a[1]) * (b[0] - a[0]) <=
+              (int64_t)x * dy) {
+            winding += dir;
+            crossings++;
+          }
+        }
+        if (nonzero ? (winding != 0) : (crossings & 1)) {
+          drawPixel(x, y, color);
+        }
+      }
+    }
+  }
+
+  // A pixel is in the circle when its center is within half a pixel of the
+  // radius, x^2 + y^2 <= r^2 + r, and between the rays when clockwise of
+  // the start and anticlockwise of the end, both of them for 180 degrees
+  // or less. The rays are rounded to 1/16384 as the library does.
+  void fillArc(int16_t x0, int16_t y0, int16_t r, int16_t ir, int16_t start,
+               int16_t end, uint16_t color) {
+    int32_t sweep = (int32_t)end - start;
+    sweep = ((sweep > -360) && (sweep < 360)) ? (sweep + 360) % 360 : 360;
+    if ((r < 0) || (ir >= r) || !sweep) {
+      return;
+    }
+    int64_t sx = lround(16384 * sin(start * M_PI / 180));
+    int64_t sy = lround(-16384 * cos(start * M_PI / 180));
+    int64_t ex = lround(16384 * sin(end * M_PI / 180));
+    int64_t ey = lround(-16384 * cos(end * M_PI / 180));
+    for (int32_t j = 0; j < _height; j++) {
+      for (int32_t i = 0; i < _width; i++) {
+        int64_t x = i - x0, y = j - y0, d = x * x + y * y;
+        if ((d > (int64_t)r * r + r) ||
+            ((ir > 0) && (d <= (int64_t)ir * ir + ir))) {
+          continue;
+        }
+        bool after = sx * y - sy * x >= 0;
+        bool before = ey * x - ex * y >= 0;
+        if ((sweep < 360) &&
+            !((sweep <= 180) ? (after && before) : (after || before))) {
+          continue;
+        }
+        drawPixel(i, j, color);
+      }
+    }
+  }
+
+  // The round brush of the curves, w across: in half pixels from its middle,
+  // the pixel centers u, v with u^2 + v^2 <= w^2. It is centered on x, y
+  // for an odd w and half a pixel down and right of it for an even one.
+  void brush(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    for (int16_t j = 0; j < w; j++) {
+      for (int16_t i = 0; i < w; i++) {
+        int32_t u = 2 * i - (w - 1), v = 2 * j - (w - 1);
+        if (u * u + v * v <= (int32_t)w * w) {
+          drawPixel(x - (w - 1) / 2 + i, y - (w - 1) / 2 + j, color);
+        }
+      }
+    }
+  }
+
+  // Dithers a w by h image, 0 black to 255 white, with the method numbers of
+  // SHARPMEM_DITHER_*, the textbook way: a Bayer
+  // map built by doubling, thresholds in the middle of each of its steps;
+  // error diffusion over an error array the size of the image, row by row
+  // left to right, dropping what falls off its edges
+  void dither(int16_t x, int16_t y, const uint8_t *img, int16_t w, int16_t h,
+              uint8_t method) {
+    if ((w <= 0) || (h <= 0)) {
+      return;
+    }
+    uint8_t size = (method == 0) ? 4 : 8;
+    std::vector<int16_t> map(1, 0);
+    for (uint8_t n = 1; n < size; n *= 2) {
+      std::vector<int16_t> next(4 * n * n);
+      for (uint8_t j = 0; j < 2 * n; j++) {
+        for (uint8_t i = 0; i < 2 * n; i++) {
+          static const int16_t quarter[2][2] = {{0, 2}, {3, 1}};
+          next[j * 2 * n + i] =
+              4 * map[(j % n) * n + i % n] + quarter[j / n][i / n];
+        }
+      }
+      map.swap(next);
+    }
+
+    std::vector<int32_t> err((int32_t)w * (h + 2), 0);
+    for (int16_t j = 0; j < h; j++) {
+      for (int16_t i = 0; i < w; i++) {
+        int32_t v = img[(int32_t)j * w + i];
+        bool white;
+        if (method < 2) {
+          int16_t step = 256 / (size * size);
+          white = v > map[(j % size) * size + i % size] * step + step / 2;
+        } else {
+          v += err[(int32_t)j * w + i];
+          white = v > 127;
+          int16_t e = v - (white ? 255 : 0);
+          if (method == 3) { // 1/8 to six neighbours
+            static const int8_t to[6][2] = {{1, 0},  {2, 0}, {-1, 1},
+                                            {0, 1},  {1, 1}, {0, 2}};
+            for (uint8_t k = 0; k < 6; k++) {
+              spread(err, w, i + to[k][0], j + to[k][1], e / 8);
+            }
+          } else { // 7/16 ahead, 3/16, 5/16 and what is left below
+            int16_t e7 = e * 7 / 16, e3 = e * 3 / 16, e5 = e * 5 / 16;
+            spread(err, w, i + 1, j, e7);
+            spread(err, w, i - 1, j + 1, e3);
+            spread(err, w, i, j + 1, e5);
+            spread(err, w, i + 1, j + 1, e - e7 - e3 - e5);
+          }
+        }
+        drawPixel(x + i, y + j, white ? 1 : 0);
+      }
+    }
+  }
+
+  // How far each pixel center is from a Bezier curve of degree 2 or 3,
+  // width() by height(), up to reach; further pixels are left at reach
+  void curveDistance(const int16_t *points, uint8_t degree, double reach,
+                     std::vector<double> &dist) const {
+    dist.assign(_width * _height, reach);
+    double length = 0;
+    for (uint8_t i = 1; i <= degree; i++) {
+      length += hypot(points[2 * i] - points[2 * i - 2],
+                      points[2 * i + 1] - points[2 * i - 1]);
+    }
+    int32_t n = 2 * (int32_t)ceil(length) + 1; // samples half a pixel apart
+    for (int32_t i = 0; i <= n; i++) {
+      double t = (double)i / n, u = 1 - t, p[2];
+      for (uint8_t k = 0; k < 2; k++) {
+        const int16_t *c = points + k;
+        p[k] = (degree == 2) ? u * u * c[0] + 2 * u * t * c[2] + t * t * c[4]
+                             : u * u * u * c[0] + 3 * u * u * t * c[2] +
+                                   3 * u * t * t * c[4] + t * t * t * c[6];
+      }
+      int32_t left = (int32_t)floor(p[0] - reach);
+      int32_t top = (int32_t)floor(p[1] - reach);
+      for (int32_t y = (top > 0) ? top : 0;
+           (y <= p[1] + reach) && (y < _height); y++) {
+        for (int32_t x = (left > 0) ? left : 0;
+             (x <= p[0] + reach) && (x < _width); x++) {
+          double d = hypot(x - p[0], y - p[1]);
+          if (d < dist[y * _width + x]) {
+            dist[y * _width + x] = d;
+          }
+        }
+      }
+    }
+  }
+
+  // What the panel shows, mirroring included
+  uint8_t panel(int16_t x, int16_t y) const {
+    x = mirrorX ? WIDTH - 1 - x : x;
+    y = mirrorY ? HEIGHT - 1 - y : y;
+    return pixels[y * WIDTH + x];
+  }
+
+  // What getPixel() returns in the current rotation
+  uint8_t user(int16_t x, int16_t y) const {
+    rotate(rotation, x, y);
+    return pixels[y * WIDTH + x];
+  }
+
+  // Where a drawing position is in the raw layout of copyPixelBuffer()
+  void raw(int16_t &x, int16_t &y) const {
+    if (!transposed || !(rotation & 1)) {
+      rotate(rotateOnRefresh ? (rotation & 1) : rotation, x, y);
+    }
+  }
+
+  // Colors 2-7 are 8x4 patterns; 0 is black and anything else white
+  static uint8_t colorAt(uint16_t color, int16_t x, int16_t y) {
+    static const uint8_t patterns[6][4] = {
+        {0xAA, 0x55, 0xAA, 0x55}, {0xAA, 0x00, 0xAA, 0x00},
+        {0x55, 0xFF, 0x55, 0xFF}, {0xEE, 0x55, 0xBB, 0x55},
+        {0xEE, 0xDD, 0xBB, 0x77}, {0x77, 0xBB, 0xDD, 0xEE}};
+    if ((color < 2) || (color > 7)) {
+      return color ? 1 : 0;
+    }
+    return (patterns[color - 2][y & 3] >> (x & 7)) & 1;
+  }
+
+  std::vector<uint8_t> pixels; // panel orientation, before mirroring
+
+private:
+  static void flip(int16_t &pos, int16_t &len) {
+    if (len < 0) {
+      len = -len;
+      pos -= len - 1;
+    }
+  }
+
+  static void spread(std::vector<int32_t> &err, int16_t w, int16_t i,
+                     int16_t j, int16_t e) {
+    if ((i >= 0) && (i < w)) {
+      err[(int32_t)j * w + i] += e;
+    }
+  }
+
+  // Where a drawing position is in the panel layout in rotation r
+  void rotate(uint8_t r, int16_t &x, int16_t &y) const {
+    int16_t t = x;
+    switch (r) {
+    case 1:
+      x = WIDTH - 1 - y;
+      y = t;
+      break;
+    case 2:
+      x = WIDTH - 1 - x;
+      y = HEIGHT - 1 - y;
+      break;
+    case 3:
+      x = y;
+      y = HEIGHT - 1 - t;
+      break;
+    }
+  }
+};
+
+#endif
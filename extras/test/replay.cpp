@@ -0,0 +1,51 @@
+// Replays a trace recorded with SHARPMEM_TRACE into a virtual panel and
+// saves what the panel shows as PBM images, one after every chip select
+// pulse that wrote lines or cleared the panel.
+//
+//   replay trace.bin width height [prefix]
+//
+// writes prefix-000.pbm, prefix-001.pbm, ... ("frame" by default) and prints
+// what was sent.
+#include "host.h"
+
+int main(int argc, char **argv) {
+  if (argc < 4) {
+    fprintf(stderr, "usage: %s trace width height [prefix]\n", argv[0]);
+    return 2;
+  }
+  FILE *f = fopen(argv[1], "rb");
+  if (!f) {
+    perror(argv[1]);
+    return 1;
+  }
+  std::vector<uint8_t> trace;
+  int c;
+  while ((c = fgetc(f)) != EOF) {
+    trace.push_back(c);
+  }
+  fclose(f);
+
+  VirtualPanel panel(atoi(argv[2]), atoi(argv[3]));
+  const char *prefix = (argc > 4) ? argv[4] : "frame";
+  uint32_t images = 0;
+  for (size_t i = 0; i < trace.size();) {
+    uint32_t lines = panel.lines, clears = panel.clears;
+    size_t n = panel.replayRecord(&trace[i], trace.size() - i);
+    if (!n) {
+      fprintf(stderr, "%s: %s at byte %zu\n", argv[1], panel.error, i);
+      return 1;
+    }
+    i += n;
+    if ((panel.lines != lines) || (panel.clears != clears)) {
+      char path[256];
+      snprintf(path, sizeof(path), "%s-%03u.pbm", prefix, images++);
+      if (!panel.writePBM(path)) {
+        perror(path);
+        return 1;
+      }
+    }
+  }
+  printf("%u commands, %u bytes, %u lines, %u clears, %u images\n",
+         panel.commands, panel.bytes, panel.lines, panel.clears, images);
+  return 0;
+}
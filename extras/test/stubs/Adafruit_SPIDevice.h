@@ -0,0 +1,33 @@
+// Adafruit BusIO's SPI device for the host build. Everything sent is logged
+// in hostBus with the chip select edges, see host.h
+#ifndef HOST_ADAFRUIT_SPIDEVICE_H
+#define HOST_ADAFRUIT_SPIDEVICE_H
+
+#include <Arduino.h>
+#include <SPI.h>
+
+typedef enum { SPI_BITORDER_MSBFIRST, SPI_BITORDER_LSBFIRST } BusIOBitOrder;
+
+void hostSend(const uint8_t *buffer, size_t len);
+void hostTransaction(bool begin);
+
+class Adafruit_SPIDevice {
+public:
+  Adafruit_SPIDevice(int8_t cs, uint32_t freq = 1000000,
+                     BusIOBitOrder order = SPI_BITORDER_MSBFIRST,
+                     uint8_t mode = SPI_MODE0, SPIClass *theSPI = &SPI) {}
+  Adafruit_SPIDevice(int8_t cs, int8_t sck, int8_t miso, int8_t mosi,
+                     uint32_t freq = 1000000,
+                     BusIOBitOrder order = SPI_BITORDER_MSBFIRST,
+                     uint8_t mode = SPI_MODE0) {}
+  bool begin(void) { return true; }
+  void transfer(uint8_t *buffer, size_t len) { hostSend(buffer, len); }
+  uint8_t transfer(uint8_t b) {
+    hostSend(&b, 1);
+    return 0;
+  }
+  void beginTransaction(void) { hostTransaction(true); }
+  void endTransaction(void) { hostTransaction(false); }
+};
+
+#endif
@@ -0,0 +1,12 @@
+// SPI for the host build, the bus itself is Adafruit_SPIDevice
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+#include <Arduino.h>
+
+#define SPI_MODE0 0
+
+class SPIClass {};
+extern SPIClass SPI;
+
+#endif